@@ -6,6 +6,7 @@
 #include <queue>
 #include <vector>
 #include "gridmap.hpp"
+#include "landmarks.hpp"
 using namespace std;
 using namespace movingai;
 
@@ -40,17 +41,46 @@ class Astar {
     }
   };
 
+  // g-value and parent of a cell, only valid when `round`
+  // matches the current search (see SIPP::GVar)
+  struct GVar {
+    double g;
+    int parent;
+    int round;
+  };
+
 public:
   int width, height;
-  vector<double> gtable;
-  gridmap grid;
+  vector<GVar> gtable;
+  int global_round = 0;
+  const gridmap &grid;
+  // number of nodes expanded by the last `run`
+  int expanded = 0;
+  // optional differential heuristic (8-connected), owned by the caller
+  const Landmarks *landmarks = nullptr;
 
   Astar(const gridmap &grid, int w, int h) : grid(grid), width(w), height(h) {
-    gtable.resize(w * h);
+    gtable.resize(w * h, {0, -1, 0});
   };
 
   inline int id(const State &loc) const { return loc.y * width + loc.x; }
 
+  inline double gval(int cid) const {
+    if (gtable[cid].round == global_round)
+      return gtable[cid].g;
+    return numeric_limits<double>::max();
+  }
+
+  // start a new search in O(1): entries of older rounds become invalid
+  inline void next_round() {
+    if (global_round == numeric_limits<int>::max()) {
+      for (auto &v : gtable)
+        v.round = 0;
+      global_round = 0;
+    }
+    global_round++;
+  }
+
   inline double hVal(const State &a, const State &b) {
     // no heuristic
     // return 0;
@@ -66,7 +96,8 @@ public:
     // * what's the meaning of this heuristic?
     int diag = min(abs(a.x - b.x), abs(a.y - b.y));
     int card = abs(a.x - b.x) + abs(a.y - b.y) - 2*diag;
-    return card + diag * SQRT2;
+    double h = card + diag * SQRT2;
+    return landmarks ? max(h, landmarks->h(a, b)) : h;
   }
 
   inline double run(int sx, int sy, int gx, int gy, vector<int> &parent) {
@@ -74,49 +105,54 @@ public:
     Node goal(gx, gy);
     Node start(sx, sy);
     start.h = hVal(start.loc, start.loc);
-    gtable.assign(static_cast<size_t>(width) * height, numeric_limits<double>::max());
-    parent.assign(static_cast<size_t>(width) * height, -1);
+    next_round();
+    expanded = 0;
 
     assert(gtable.size() >= width * height);
-		// std::fill(gtable.begin(), gtable.end(), numeric_limits<double>::max());
-    gtable[id(start.loc)] = 0;
+    gtable[id(start.loc)] = {0, -1, global_round};
 
-		// parent.resize(width * height);
-    assert(parent.size() >= width * height);
-		// std::fill(parent.begin(), parent.end(), -1);
+    // only cells on the returned path are written,
+    // other entries may be left over from earlier queries
+    if (parent.size() < static_cast<size_t>(width) * height)
+      parent.resize(static_cast<size_t>(width) * height, -1);
     parent[id(start.loc)] = -1;
 
 		// before move on, any other preconditions are not satisfied?
 
+    // start and goal in different components: nothing to search
+    if (!grid.same_component(start.loc, goal.loc))
+      return -1;
+
     q.push(start);
 
     while (!q.empty()) {
       Node c = q.top();
       q.pop();
+      expanded++;
 
       // what if (c.g > gtable[id(c.loc)]) ?
       // Is it possible?
 
       if (c.isAt(goal.loc)) {
         // TODO: at goal location, what to do?
-        double optimalDist = gtable[id(c.loc)];; // what's the `optimalDist` suppose to be?
+        double optimalDist = gval(id(c.loc)); // what's the `optimalDist` suppose to be?
+        for (int cid = id(c.loc); cid != -1; cid = gtable[cid].parent)
+          parent[cid] = gtable[cid].parent;
         return optimalDist;       // what if not return? `continiue` instead?
       }
 
-      vector<State> successors = grid.get_neighbours(c.loc);
-      for (auto &suc : successors) {
-        double w = (c.loc.x == suc.x || c.loc.y == suc.y) ? 1 : SQRT2;
+      grid.for_each_neighbour(c.loc, [&](State suc, int dir) {
+        double w = dir < 4 ? 1 : SQRT2;
         auto x = suc.x;
         auto y = suc.y;
         // what if gtable[..] == c.g + w ?
-        if (gtable[id(suc)] > c.g + w) {
-          gtable[id(suc)] = c.g + w;
-          parent[id(suc)] = id(c.loc);
+        if (gval(id(suc)) > c.g + w) {
+          gtable[id(suc)] = {c.g + w, id(c.loc), global_round};
           Node nxt = {x, y, c.g + w};
           nxt.h = hVal(nxt.loc, goal.loc);
           q.push(nxt);
         }
-      }
+      });
     }
     return -1;
   }
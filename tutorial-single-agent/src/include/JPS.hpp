@@ -0,0 +1,238 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <math.h>
+#include <queue>
+#include <vector>
+#include "gridmap.hpp"
+#include "landmarks.hpp"
+using namespace std;
+using namespace movingai;
+
+// Jump Point Search (online jumping, no corner-cutting) on an octile gridmap.
+// Same contract as `Astar::run`: returns the optimal distance or -1, and
+// fills `parent` cell by cell along the returned path.
+class JPS {
+
+protected:
+  const double SQRT2 = 1.41421356237;
+
+  struct Node {
+    State loc;
+    double g = 0;
+    double h = 0;
+
+    Node(int x, int y, double g = 0.0, double h = 0.0) {
+      this->loc = State{x, y};
+      this->g = g;
+      this->h = h;
+    }
+
+    inline bool isAt(const State &other) const {
+      return loc.x == other.x && loc.y == other.y;
+    }
+
+    inline double f() const { return g + h; }
+
+    inline bool operator<(const Node &rhs) const {
+      if (f() == rhs.f())
+        return g > rhs.g;
+      else
+        return f() > rhs.f();
+    }
+  };
+
+  // g-value and parent jump point, valid in round `round` only
+  struct GVar {
+    double g;
+    int parent;
+    int round;
+  };
+
+public:
+  int width, height;
+  vector<GVar> gtable;
+  int global_round = 0;
+  const gridmap &grid;
+  // number of jump points expanded by the last `run`
+  int expanded = 0;
+  // optional differential heuristic (8-connected), owned by the caller
+  const Landmarks *landmarks = nullptr;
+
+  JPS(const gridmap &grid, int w, int h) : width(w), height(h), grid(grid) {
+    gtable.resize(w * h, {0, -1, 0});
+  };
+
+  inline int id(const State &loc) const { return loc.y * width + loc.x; }
+
+  inline double gval(int cid) const {
+    if (gtable[cid].round == global_round)
+      return gtable[cid].g;
+    return numeric_limits<double>::max();
+  }
+
+  inline void next_round() {
+    if (global_round == numeric_limits<int>::max()) {
+      for (auto &v : gtable)
+        v.round = 0;
+      global_round = 0;
+    }
+    global_round++;
+  }
+
+  inline double hVal(const State &a, const State &b) {
+    int diag = min(abs(a.x - b.x), abs(a.y - b.y));
+    int card = abs(a.x - b.x) + abs(a.y - b.y) - 2 * diag;
+    double h = card + diag * SQRT2;
+    return landmarks ? max(h, landmarks->h(a, b)) : h;
+  }
+
+  // index of the move (dx, dy) in `gridmap::dx/dy`
+  static inline int dir_of(int dx, int dy) {
+    if (dy == 0)
+      return dx > 0 ? 0 : 1;
+    if (dx == 0)
+      return dy > 0 ? 2 : 3;
+    return 4 + (dx < 0) + 2 * (dy < 0);
+  }
+
+  inline bool passable(int x, int y) const { return !grid.is_obstacle({x, y}); }
+
+  // a straight move (dx, dy) into (x, y) has a forced neighbour
+  // when a side cell is free but the cell behind it is blocked
+  inline bool forced(int x, int y, int dx, int dy) const {
+    if (dx != 0)
+      return (passable(x, y + 1) && !passable(x - dx, y + 1)) ||
+             (passable(x, y - 1) && !passable(x - dx, y - 1));
+    return (passable(x + 1, y) && !passable(x + 1, y - dy)) ||
+           (passable(x - 1, y) && !passable(x - 1, y - dy));
+  }
+
+  // jump from (x, y) along a cardinal direction,
+  // return the steps taken to the next jump point, or -1
+  inline int jump_straight(int x, int y, int dx, int dy, const State &goal) const {
+    int bit = 1 << dir_of(dx, dy);
+    int steps = 0;
+    while (grid.neighbour_mask({x, y}) & bit) {
+      x += dx;
+      y += dy;
+      steps++;
+      if ((x == goal.x && y == goal.y) || forced(x, y, dx, dy))
+        return steps;
+    }
+    return -1;
+  }
+
+  // jump from (x, y) along a diagonal, a cell is a jump point when
+  // one of the two straight jumps starting from it finds something
+  inline int jump_diag(int x, int y, int dx, int dy, const State &goal) const {
+    int bit = 1 << dir_of(dx, dy);
+    int steps = 0;
+    while (grid.neighbour_mask({x, y}) & bit) {
+      x += dx;
+      y += dy;
+      steps++;
+      if (x == goal.x && y == goal.y)
+        return steps;
+      if (jump_straight(x, y, dx, 0, goal) != -1 ||
+          jump_straight(x, y, 0, dy, goal) != -1)
+        return steps;
+    }
+    return -1;
+  }
+
+  // pruned set of directions to jump in from `c`, given its parent
+  inline uint8_t successor_dirs(const State &c, int pid) const {
+    if (pid == -1)
+      return gridmap::ALL_MOVES;
+    int px = pid % width, py = pid / width;
+    int dx = (c.x > px) - (c.x < px);
+    int dy = (c.y > py) - (c.y < py);
+    uint8_t dirs = 0;
+    if (dx != 0 && dy != 0) {
+      dirs |= 1 << dir_of(dx, 0);
+      dirs |= 1 << dir_of(0, dy);
+      dirs |= 1 << dir_of(dx, dy);
+    } else if (dx != 0) {
+      dirs |= 1 << dir_of(dx, 0);
+      for (int s : {1, -1})
+        if (passable(c.x, c.y + s) && !passable(c.x - dx, c.y + s)) {
+          dirs |= 1 << dir_of(0, s);
+          dirs |= 1 << dir_of(dx, s);
+        }
+    } else {
+      dirs |= 1 << dir_of(0, dy);
+      for (int s : {1, -1})
+        if (passable(c.x + s, c.y) && !passable(c.x + s, c.y - dy)) {
+          dirs |= 1 << dir_of(s, 0);
+          dirs |= 1 << dir_of(s, dy);
+        }
+    }
+    return dirs;
+  }
+
+  inline double run(int sx, int sy, int gx, int gy, vector<int> &parent) {
+    priority_queue<Node, vector<Node>, less<Node>> q;
+    Node goal(gx, gy);
+    Node start(sx, sy);
+    start.h = hVal(start.loc, goal.loc);
+    next_round();
+    expanded = 0;
+
+    gtable[id(start.loc)] = {0, -1, global_round};
+    // start and goal in different components: nothing to search
+    if (!grid.same_component(start.loc, goal.loc))
+      return -1;
+
+    q.push(start);
+
+    while (!q.empty()) {
+      Node c = q.top();
+      q.pop();
+      if (c.g > gval(id(c.loc)))
+        continue;
+      expanded++;
+
+      if (c.isAt(goal.loc)) {
+        fill_parent(start.loc, goal.loc, parent);
+        return gval(id(c.loc));
+      }
+
+      grid.for_each_neighbour(c.loc, [&](State, int dir) {
+        int dx = gridmap::dx[dir], dy = gridmap::dy[dir];
+        int steps = dir < 4 ? jump_straight(c.loc.x, c.loc.y, dx, dy, goal.loc)
+                            : jump_diag(c.loc.x, c.loc.y, dx, dy, goal.loc);
+        if (steps == -1)
+          return;
+        State suc{c.loc.x + steps * dx, c.loc.y + steps * dy};
+        double g = c.g + steps * (dir < 4 ? 1 : SQRT2);
+        if (gval(id(suc)) > g) {
+          gtable[id(suc)] = {g, id(c.loc), global_round};
+          q.push(Node(suc.x, suc.y, g, hVal(suc, goal.loc)));
+        }
+      }, successor_dirs(c.loc, gtable[id(c.loc)].parent));
+    }
+    return -1;
+  }
+
+  // jump points are joined by straight or diagonal segments, write `parent`
+  // so that it links every cell on the path; other entries are left as is
+  inline void fill_parent(const State &s, const State &g, vector<int> &parent) const {
+    if (parent.size() < static_cast<size_t>(width) * height)
+      parent.resize(static_cast<size_t>(width) * height, -1);
+    parent[id(s)] = -1;
+    State c = g;
+    while (c.x != s.x || c.y != s.y) {
+      int pid = gtable[id(c)].parent;
+      State p{pid % width, pid / width};
+      int dx = (c.x > p.x) - (c.x < p.x);
+      int dy = (c.y > p.y) - (c.y < p.y);
+      while (c.x != p.x || c.y != p.y) {
+        State prev{c.x - dx, c.y - dy};
+        parent[id(c)] = id(prev);
+        c = prev;
+      }
+    }
+  }
+};
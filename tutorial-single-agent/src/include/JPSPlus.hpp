@@ -0,0 +1,180 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "JPS.hpp"
+#include "gridmap.hpp"
+using namespace std;
+using namespace movingai;
+
+// JPS+: jump distances of every cell in every direction are precomputed once,
+// so a query looks successors up instead of scanning the grid.
+//
+// Table entry `jd[id * 8 + dir]` (dir indexes `gridmap::dx/dy`):
+//  * k > 0: the k-th cell along `dir` is a jump point
+//  * k <= 0: -k legal steps along `dir` before hitting a wall
+//
+// The table is cached in a sidecar file `<mapfile>.jpsp` and rebuilt
+// whenever its header does not match the map (size or content hash).
+class JPSPlus : public JPS {
+
+  struct SidecarHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height;
+    uint64_t map_hash;
+  };
+  static constexpr char MAGIC[4] = {'J', 'P', 'S', 'P'};
+  static constexpr uint32_t VERSION = 1;
+
+public:
+  vector<int16_t> jd;
+  // whether the table was read from the sidecar rather than rebuilt
+  bool loaded = false;
+
+  JPSPlus(const gridmap &grid, int w, int h) : JPS(grid, w, h) {
+    assert(max(w, h) <= numeric_limits<int16_t>::max());
+    string sidecar = sidecar_path();
+    if (!sidecar.empty() && load(sidecar))
+      loaded = true;
+    else {
+      preprocess();
+      if (!sidecar.empty())
+        save(sidecar);
+    }
+  }
+
+  inline string sidecar_path() const {
+    return grid.filename.empty() ? "" : grid.filename + ".jpsp";
+  }
+
+  void preprocess() {
+    jd.assign(static_cast<size_t>(width) * height * 8, 0);
+    // straight directions first, diagonal entries are built on top of them
+    for (int dir = 0; dir < 8; dir++) {
+      int dx = gridmap::dx[dir], dy = gridmap::dy[dir];
+      // visit cells so that (x + dx, y + dy) is done before (x, y)
+      for (int i = 0; i < height; i++) {
+        int y = dy > 0 ? height - 1 - i : i;
+        for (int j = 0; j < width; j++) {
+          int x = dx > 0 ? width - 1 - j : j;
+          jd[id({x, y}) * 8 + dir] = scan(x, y, dir);
+        }
+      }
+    }
+  }
+
+  bool load(const string &fn) {
+    ifstream fin(fn, ios::binary);
+    if (!fin.is_open())
+      return false;
+    SidecarHeader hd;
+    if (!fin.read(reinterpret_cast<char *>(&hd), sizeof(hd)))
+      return false;
+    if (memcmp(hd.magic, MAGIC, 4) != 0 || hd.version != VERSION ||
+        hd.width != (uint32_t)width || hd.height != (uint32_t)height ||
+        hd.map_hash != grid.hash())
+      return false;
+    jd.resize(static_cast<size_t>(width) * height * 8);
+    return (bool)fin.read(reinterpret_cast<char *>(jd.data()),
+                          jd.size() * sizeof(int16_t));
+  }
+
+  // the sidecar is only a cache, failing to write it is not an error
+  void save(const string &fn) const {
+    ofstream fout(fn, ios::binary | ios::trunc);
+    if (!fout.is_open())
+      return;
+    SidecarHeader hd;
+    memcpy(hd.magic, MAGIC, 4);
+    hd.version = VERSION;
+    hd.width = width;
+    hd.height = height;
+    hd.map_hash = grid.hash();
+    fout.write(reinterpret_cast<const char *>(&hd), sizeof(hd));
+    fout.write(reinterpret_cast<const char *>(jd.data()),
+               jd.size() * sizeof(int16_t));
+  }
+
+  inline double run(int sx, int sy, int gx, int gy, vector<int> &parent) {
+    priority_queue<Node, vector<Node>, less<Node>> q;
+    Node goal(gx, gy);
+    Node start(sx, sy);
+    start.h = hVal(start.loc, goal.loc);
+    next_round();
+    expanded = 0;
+
+    gtable[id(start.loc)] = {0, -1, global_round};
+    // start and goal in different components: nothing to search
+    if (!grid.same_component(start.loc, goal.loc))
+      return -1;
+
+    q.push(start);
+
+    while (!q.empty()) {
+      Node c = q.top();
+      q.pop();
+      if (c.g > gval(id(c.loc)))
+        continue;
+      expanded++;
+
+      if (c.isAt(goal.loc)) {
+        fill_parent(start.loc, goal.loc, parent);
+        return gval(id(c.loc));
+      }
+
+      const int16_t *row = &jd[id(c.loc) * 8];
+      grid.for_each_neighbour(c.loc, [&](State, int dir) {
+        int steps = successor_steps(c.loc, goal.loc, dir, row[dir]);
+        if (steps <= 0)
+          return;
+        State suc{c.loc.x + steps * gridmap::dx[dir], c.loc.y + steps * gridmap::dy[dir]};
+        double g = c.g + steps * (dir < 4 ? 1 : SQRT2);
+        if (gval(id(suc)) > g) {
+          gtable[id(suc)] = {g, id(c.loc), global_round};
+          q.push(Node(suc.x, suc.y, g, hVal(suc, goal.loc)));
+        }
+      }, successor_dirs(c.loc, gtable[id(c.loc)].parent));
+    }
+    return -1;
+  }
+
+private:
+  // table entry of (x, y) along `dir`, assuming the entry of the next cell
+  // along `dir` (and the straight entries for diagonals) are already known
+  int16_t scan(int x, int y, int dir) const {
+    if (!(grid.neighbour_mask({x, y}) & (1 << dir)))
+      return 0;
+    int dx = gridmap::dx[dir], dy = gridmap::dy[dir];
+    int nx = x + dx, ny = y + dy;
+    bool jump_point;
+    if (dir < 4)
+      jump_point = forced(nx, ny, dx, dy);
+    else
+      jump_point = jd[id({nx, ny}) * 8 + dir_of(dx, 0)] > 0 ||
+                   jd[id({nx, ny}) * 8 + dir_of(0, dy)] > 0;
+    if (jump_point)
+      return 1;
+    int16_t k = jd[id({nx, ny}) * 8 + dir];
+    return k > 0 ? k + 1 : k - 1;
+  }
+
+  // steps to the successor of `c` along `dir`, or 0; the goal is a successor
+  // (straight) or yields a target jump point (diagonal) when within reach
+  inline int successor_steps(const State &c, const State &goal, int dir, int16_t k) const {
+    int dx = gridmap::dx[dir], dy = gridmap::dy[dir];
+    int reach = k > 0 ? k : -k;
+    int ax = (goal.x - c.x) * dx, ay = (goal.y - c.y) * dy;
+    if (dir < 4) {
+      int along = dx != 0 ? ax : ay;
+      bool on_ray = dx != 0 ? goal.y == c.y : goal.x == c.x;
+      if (on_ray && along > 0 && along <= reach)
+        return along;
+    } else if (ax > 0 && ay > 0 && min(ax, ay) <= reach) {
+      return min(ax, ay);
+    }
+    return k > 0 ? k : 0;
+  }
+};
@@ -8,13 +8,19 @@
 #include <set>
 #include <tuple>
 #include <map>
+#include <unordered_map>
 #include "gridmap.hpp"
+#include "cstr_table.hpp"
 #include "dynscens.hpp"
+#include "landmarks.hpp"
+#include "motion.hpp"
 using namespace std;
 using namespace movingai;
 
 
-class SIPP {
+// `Motion` is a `motion::Model`, the moves and their durations
+template <typename Motion>
+class BasicSIPP {
 public:
   using gridmap = movingai::gridmap;
   using Time = dynenv::Time;
@@ -94,17 +100,23 @@ public:
     vector<Node> nodes;
     vector<int> parent;
     //std::map<std::tuple<vid, vid, Time_interval>, Cost> state_g_values;
-    vector<vector<GVar>> gtable;
+    // one entry per safe interval, see `dynenv::CSTRTable::safe_index`
+    vector<GVar> gtable;
     ID bestID, curID;
     Cost best;
+    // nodes expanded by the last search
+    size_t expanded = 0;
 
     int width, height;
     int global_round = 0;
     const gridmap &grid;
-    const dynenv::NodeCSTRs &cstrs;
-
-    std::map<vid, std::vector<Time_interval>> all_safe_intervals;
-    Time max_time = std::numeric_limits<int>::max();
+    // constraints and safe intervals, possibly shared with other solvers;
+    // `own` is set once this solver holds a private, modifiable copy
+    shared_ptr<const dynenv::CSTRTable> table;
+    shared_ptr<dynenv::CSTRTable> own;
+    // optional differential heuristic, built with `gridmap::CARDINAL` moves;
+    // waiting only adds time, so static distances stay admissible
+    const Landmarks *landmarks = nullptr;
 
     inline ID gen_node(int x, int y, Time_interval interval = {0, 0}, Cost g = 0, Cost h = 0, Time arrival_t = 0) {
         if (nodes.size() + 1 >= nodes.capacity()) {
@@ -118,28 +130,51 @@ public:
         return nodes.size() - 1;
     }
 
-    SIPP(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h)
-      : grid(g), cstrs(cs), width(w), height(h){
-        init_all_safe_intervals();
-        gtable.resize(w * h);
-        for (int i = 0; i < h * w; i++) {
-            if (cstrs.find(i) == cstrs.end())
-                gtable[i].resize(1);
-            else
-                gtable[i].resize(cstrs.at(i).size() + 1);
-        }
+    BasicSIPP(const gridmap &g, shared_ptr<const dynenv::CSTRTable> tb, int w, int h)
+      : grid(g), table(std::move(tb)), width(w), height(h){
+        gtable.resize(table->num_slots(), {0, 0});
       };
 
+    // `threads` > 1 builds the table in parallel, see `dynenv::CSTRTable`
+    BasicSIPP(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h, int threads = 1)
+      : BasicSIPP(g, make_shared<dynenv::CSTRTable>(g, cs, false, threads), w, h) {
+        own = const_pointer_cast<dynenv::CSTRTable>(table);
+      }
+
+    // patch the constraints of one cell, only its safe intervals are
+    // rederived; a shared table is copied on the first update
+    void add_constraint(vid cell, const dynenv::Interval &iv) {
+        writable().add_constraint(cell, iv);
+    }
+
+    bool remove_constraint(vid cell, const dynenv::Interval &iv) {
+        return writable().remove_constraint(cell, iv);
+    }
+
     inline vid id(const vid &x, const vid &y) const { return y * width + x; }
 
     inline double hVal(const vid &x, const vid &y, const vid &gx, const vid &gy) {
-		// using Manhattans distance in 4-connected grid
-        return abs(x - gx) + abs(y - gy);
+		// fewest time steps on an empty map under the motion model
+        double h = Motion::h(x, y, gx, gy);
+        if constexpr (Motion::dirs == gridmap::CARDINAL) {
+            return landmarks ? max(h, landmarks->h({x, y}, {gx, gy})) : h;
+        }
+        return h;
+    }
+
+    // g-slot of a safe interval, lazy tables and updates add slots
+    inline GVar &slot(vid cid, int key) {
+        size_t i = table->safe_index(cid, key);
+        if (i >= gtable.size()) {
+            gtable.resize(std::max(i + 1, gtable.size() * 2), {0, 0});
+        }
+        return gtable[i];
     }
 
     inline Cost gval(vid cid, int key) {
-        if(gtable[cid][key].round == global_round) {
-            return gtable[cid][key].g;
+        const GVar &v = slot(cid, key);
+        if(v.round == global_round) {
+            return v.g;
         }
         else {
             return INFT;
@@ -153,75 +188,69 @@ public:
         bestID = -1;
         curID = -1;
         best = -1;
+        expanded = 0;
         global_round++;
     }
 
-    void init_all_safe_intervals() {
-        all_safe_intervals.clear();
-        for (int x = 0; x < width; ++x) {
-            for (int y = 0; y < height; ++y) {
-                vid c_id = y * width + x;
-                if (grid.is_obstacle({x, y})) {
-                    all_safe_intervals[c_id] = {};
-                    continue;
-                }
-
-                std::vector<Time_interval> unsafe_intervals;
-                auto constraints = cstrs.find(c_id);
-                if (constraints != cstrs.end()) {
-                    for (const auto& constraint : constraints->second) {
-                        unsafe_intervals.emplace_back(constraint.tl, constraint.tr, -1);
-                    }
-                }
-
-                std::sort(unsafe_intervals.begin(), unsafe_intervals.end());
-
-                std::vector<Time_interval> safe_intervals;
-                Time last_unsafe_end = -1;
-                int current_key = 0;
-                for (const auto& unsafe_interval : unsafe_intervals) {
-                    if (unsafe_interval.start > last_unsafe_end + 1) {
-                        safe_intervals.push_back({last_unsafe_end + 1, unsafe_interval.start - 1, current_key++});
-                    }
-                    last_unsafe_end = std::max(last_unsafe_end, unsafe_interval.end);
-                }
-
-                if (last_unsafe_end < max_time -1) {
-                    safe_intervals.push_back({last_unsafe_end + 1, max_time -1, current_key++});
-                }
-                else if (unsafe_intervals.empty()) {
-                    safe_intervals.push_back({0, max_time -1, current_key++});
-                }
-                all_safe_intervals[c_id] = safe_intervals;
-            }
+    dynenv::CSTRTable &writable() {
+        if (!own) {
+            own = make_shared<dynenv::CSTRTable>(*table);
+            table = own;
         }
+        return *own;
     }
 
     inline const Node &cur() const { return this->nodes.at(curID); }
 
     Time get_target_critical_time(vid target_gx, vid target_gy) const {
-        Time max_tr_at_target = -1;
-        long target_node_id = id(target_gx, target_gy);
-  
-        auto it = cstrs.find(target_node_id);
-        if (it != cstrs.end()) {
-            if (it->second.empty()) {
-                return 0;
-            }
-            for (const auto& constraint : it->second) {
-                if (constraint.tr > max_tr_at_target) {
-                    max_tr_at_target = constraint.tr;
+        return table->critical_time(id(target_gx, target_gy));
+    }
+
+    // generate the successors of `cur()` into `q`, `h(x, y)` estimates
+    // the cost left from a cell
+    template <typename Queue, typename H>
+    void expand(Queue &q, H &&h) {
+        expanded++;
+        // the model's moves that the neighbour mask allows, unrolled
+        Motion::for_each_move(grid.neighbour_mask({cur().state.x, cur().state.y}), [&](vid dx, vid dy, int w) {
+            vid nx = cur().state.x + dx;
+            vid ny = cur().state.y + dy;
+            Time nt = cur().arrival_time + w;
+            vid nid_cell = id(nx, ny);
+            // only intervals overlapping [nt, cur end + 1] can be entered:
+            // skip to the first one ending at or after nt, stop at the
+            // first one starting after the window
+            for(int key = table->first_safe_from(nid_cell, nt); key < table->num_safe(nid_cell); key++) {
+                const auto& iv = table->safe_begin(nid_cell)[key];
+                if(iv.tl > cur().state.interval.end + 1) {
+                    break;
+                }
+                Time_interval interval(iv.tl, iv.tr, key);
+                Time new_arrival_time = std::max(nt, interval.start);
+                // the cell is held until the last step of the move
+                if(cur().state.interval.end < new_arrival_time - 1) {
+                    continue;
                 }
+                if(new_arrival_time > interval.end || new_arrival_time < interval.start) {
+                    continue;
+                }
+                if(gval(id(nx, ny), interval.key) <= new_arrival_time) {
+                    continue;
+                }
+                ID nid = gen_node(nx, ny, interval, new_arrival_time, h(nx, ny), new_arrival_time);
+                slot(nid_cell, key) = {new_arrival_time, global_round};
+                q.push(nid);
+                parent[nid] = curID;
             }
-        } else {
-            return 0;
-        }
-  
-        return (max_tr_at_target == -1) ? 0 : max_tr_at_target;
+        });
     }
 
     Cost run(vid sx, vid sy, vid gx, vid gy) {
         init_search();
+        // waiting never connects two components: the goal is unreachable
+        if (!grid.same_component({sx, sy}, {gx, gy}, Motion::connectivity)) {
+            return best;
+        }
         Time critical_time = get_target_critical_time(gx, gy);
 
 		// The priority_queue only store index of the data,
@@ -234,15 +263,15 @@ public:
         best = bestID = -1;
         vid grid_id = sy * width + sx;
 
-        auto it_start_intervals = all_safe_intervals.find(grid_id);
-        if (it_start_intervals == all_safe_intervals.end() || it_start_intervals->second.empty()) {
+        if (table->num_safe(grid_id) == 0) {
             return -1;
         }
-        const std::vector<Time_interval>& safe_intervals = it_start_intervals->second;
-        for (const auto& interval : safe_intervals) {
+        for (int key = 0; key < table->num_safe(grid_id); key++) {
+          const auto& iv = table->safe_begin(grid_id)[key];
+          Time_interval interval(iv.tl, iv.tr, key);
           q.push(gen_node(sx, sy, interval, interval.start, hVal(sx, sy, gx, gy), interval.start));
           //state_g_values[{sx, sy, interval}] = interval.start;
-          gtable[id(sx, sy)][interval.key] = {interval.start, global_round};
+          slot(grid_id, key) = {interval.start, global_round};
         }
 
         while (!q.empty()) {
@@ -266,52 +295,165 @@ public:
           //}
           if(gval(id(cur().state.x, cur().state.y), cur().state.interval.key) < cur().arrival_time)
             continue;
+          expand(q, [&](vid x, vid y) { return hVal(x, y, gx, gy); });
+        }
+        return best;
+    }
 
-          
-            const static int nummoves = 5;
-            const static vid dx[] = {1, -1, 0, 0, 0};
-            const static vid dy[] = {0, 0, 1, -1, 0};
-            const static Cost w[] = {1, 1, 1, 1, 1};
-
-            for(int i = 0; i < nummoves; i++) {
-                vid nx = cur().state.x + dx[i];
-                vid ny = cur().state.y + dy[i];
-                Time nt = cur().arrival_time + w[i];
-                if(nx < 0 || nx >= width || ny < 0 || ny >= height || grid.is_obstacle({nx, ny})) {
-                    continue;
-                }
-                if(all_safe_intervals.find(ny * width + nx) == all_safe_intervals.end())
-                {
-                    continue;
-                }
-                const std::vector<Time_interval>& safe_intervals = all_safe_intervals.find(ny * width + nx)->second;
-                if(safe_intervals.empty()) {
-                    continue;
-                }
-                for(const auto& interval : safe_intervals) {
-                    Time new_arrival_time = std::max(nt, interval.start);
-                    if(cur().state.interval.end < new_arrival_time - 1) {
-                        continue;
-                    }
-                    if(new_arrival_time > interval.end || new_arrival_time < interval.start) {
-                        continue;
-                    }
-                    //auto it = state_g_values.find({nx, ny, interval});
-                    //if(it != state_g_values.end() && new_arrival_time >= it->second) {
-                    //    continue;
-                    //}
-                    if(gval(id(nx, ny), interval.key) <= new_arrival_time) {
-                        continue;
-                    }
-                    ID nid = gen_node(nx, ny, interval, new_arrival_time, hVal(nx, ny, gx, gy), new_arrival_time);
-                    gtable[id(nx, ny)][interval.key] = {new_arrival_time, global_round};
-                    q.push(nid);
-                    parent[nid] = curID;
-                    //state_g_values[{nx, ny, interval}] = new_arrival_time;
+    // earliest arrival at each of `targets` from one search tree; the
+    // heuristic is the smallest estimate over all targets, which stays
+    // consistent, so the first node popped at a target is optimal for it.
+    // The search ends once every target is settled, `many_best[i]` is the
+    // node reaching the i-th one (-1 if unreachable) for `get_path`.
+    vector<ID> many_best;
+
+    vector<Cost> run_many(vid sx, vid sy, const vector<pair<vid, vid>> &targets) {
+        init_search();
+        vector<Cost> costs(targets.size(), -1);
+        many_best.assign(targets.size(), -1);
+        vid grid_id = id(sx, sy);
+        // targets of each cell still waiting to be settled
+        unordered_map<vid, vector<int>> pending;
+        vector<pair<vid, vid>> live;
+        for (size_t i = 0; i < targets.size(); i++) {
+            auto [gx, gy] = targets[i];
+            if (!grid.same_component({sx, sy}, {gx, gy}, Motion::connectivity)) {
+                continue;
+            }
+            if (pending[id(gx, gy)].empty()) {
+                live.push_back(targets[i]);
+            }
+            pending[id(gx, gy)].push_back(i);
+        }
+        if (pending.empty() || table->num_safe(grid_id) == 0) {
+            return costs;
+        }
+        auto h = [&](vid x, vid y) {
+            double best_h = INFT;
+            for (auto [gx, gy] : live) {
+                best_h = std::min(best_h, hVal(x, y, gx, gy));
+            }
+            return best_h;
+        };
+
+        auto pcmp = [&](const ID &i, const ID &j) {
+            return this->nodes[i] < this->nodes[j];
+        };
+        priority_queue<int, vector<int>, decltype(pcmp)> q(pcmp);
+        for (int key = 0; key < table->num_safe(grid_id); key++) {
+            const auto& iv = table->safe_begin(grid_id)[key];
+            Time_interval interval(iv.tl, iv.tr, key);
+            q.push(gen_node(sx, sy, interval, interval.start, h(sx, sy), interval.start));
+            slot(grid_id, key) = {interval.start, global_round};
+        }
+
+        size_t left = pending.size();
+        while (!q.empty() && left > 0) {
+            curID = q.top();
+            q.pop();
+            if(gval(id(cur().state.x, cur().state.y), cur().state.interval.key) < cur().arrival_time)
+                continue;
+            auto it = pending.find(id(cur().state.x, cur().state.y));
+            if (it != pending.end() && !it->second.empty()) {
+                for (int i : it->second) {
+                    costs[i] = cur().g;
+                    many_best[i] = curID;
                 }
+                it->second.clear();
+                left--;
+            }
+            expand(q, h);
+        }
+        return costs;
+    }
+
+    // bounded-suboptimal search for latency-capped planning: OPEN is ordered
+    // by f, FOCAL holds the open nodes with f <= w * f_min and expands
+    // first the one with the fewest steps left, then the one in the cell
+    // with the fewest safe intervals, i.e. the least constrained. The
+    // smallest f in OPEN never exceeds the optimal cost, so when a goal
+    // node leaves FOCAL its cost is at most w times `lower_bound`, and
+    // `best / lower_bound` certifies the suboptimality actually incurred.
+    Cost lower_bound = -1;
+
+    struct FocalLists {
+        BasicSIPP &solver;
+        double w;
+        // FOCAL holds exactly the open nodes with f <= bound
+        double bound = -1;
+        // (f, g, id), smallest first with larger g breaking ties like `Node`
+        set<tuple<double, Cost, ID>> open;
+        // (h, safe intervals of the cell, f, id)
+        set<tuple<Cost, int, double, ID>> focal;
+
+        FocalLists(BasicSIPP &solver, double w) : solver(solver), w(w) {}
+
+        inline tuple<double, Cost, ID> open_key(ID i) const {
+            const Node &n = solver.nodes[i];
+            return {n.f(), -n.g, i};
+        }
+        inline tuple<Cost, int, double, ID> focal_key(ID i) const {
+            const Node &n = solver.nodes[i];
+            return {n.h, solver.table->num_safe(solver.id(n.state.x, n.state.y)), n.f(), i};
+        }
+        inline double f_min() const { return get<0>(*open.begin()); }
+
+        void push(ID i) {
+            if (solver.nodes[i].f() <= bound) {
+                focal.insert(focal_key(i));
             }
+            open.insert(open_key(i));
+        }
 
+        ID pop() {
+            ID i = get<3>(*focal.begin());
+            focal.erase(focal.begin());
+            open.erase(open_key(i));
+            return i;
+        }
 
+        // raise the bound to w * f_min; children are never better than
+        // their parent, so f_min only grows between two refreshes
+        void refresh() {
+            if (w * f_min() <= bound) {
+                return;
+            }
+            for (auto it = open.upper_bound({bound, numeric_limits<Cost>::max(), 0});
+                 it != open.end() && get<0>(*it) <= w * f_min(); ++it) {
+                focal.insert(focal_key(get<2>(*it)));
+            }
+            bound = w * f_min();
+        }
+    };
+
+    Cost run_focal(vid sx, vid sy, vid gx, vid gy, double w) {
+        init_search();
+        lower_bound = -1;
+        if (!grid.same_component({sx, sy}, {gx, gy}, Motion::connectivity)) {
+            return best;
+        }
+        auto h = [&](vid x, vid y) { return hVal(x, y, gx, gy); };
+        FocalLists q(*this, std::max(w, 1.0));
+        vid grid_id = id(sx, sy);
+        for (int key = 0; key < table->num_safe(grid_id); key++) {
+            const auto& iv = table->safe_begin(grid_id)[key];
+            Time_interval interval(iv.tl, iv.tr, key);
+            q.push(gen_node(sx, sy, interval, interval.start, h(sx, sy), interval.start));
+            slot(grid_id, key) = {interval.start, global_round};
+        }
+        while (!q.open.empty()) {
+            q.refresh();
+            double f_min = q.f_min();
+            curID = q.pop();
+            if (cur().isAt(gx, gy)) {
+                best = cur().g;
+                bestID = curID;
+                lower_bound = f_min;
+                break;
+            }
+            if(gval(id(cur().state.x, cur().state.y), cur().state.interval.key) < cur().arrival_time)
+                continue;
+            expand(q, h);
         }
         return best;
     }
@@ -321,13 +463,16 @@ public:
         Time t;
       };
 
-    std::vector<STState> get_path() const {
+    std::vector<STState> get_path() const { return get_path(bestID); }
+
+    // path to node `to`, e.g. an entry of `many_best`
+    std::vector<STState> get_path(ID to) const {
         std::vector<STState> path;
-        if (bestID == -1) {
+        if (to == -1) {
             return path;
         }
 
-        ID curID = bestID;
+        ID curID = to;
         while (curID != -1) {
             const Node& n = nodes.at(curID);
             path.emplace_back(n.state.x, n.state.y, n.arrival_time);
@@ -339,23 +484,12 @@ public:
     }
 
     inline bool is_safe(const vid &x, const vid &y, const vid &t) const {
-		// TODO: check whether (x, y, t) violate node constraints (cstrs) 
+		// TODO: check whether (x, y, t) violate node constraints (table) 
         if (x < 0 || x >= width || y < 0 || y >= height || t < 0)
             return false;
         if(grid.is_obstacle({x, y})) 
             return false; 
-        long node_id = y * width + x;
-        auto it = cstrs.find(node_id);
-        if(it == cstrs.end()) 
-            return true;
-        else {
-            for(auto intervals : it->second) {
-                if(intervals.is_in(t))
-                    return false;
-            }
-            return true;
-        }
-        return false;
+        return table->is_safe(id(x, y), t);
     }
 
     inline bool validate(const vector<STState> &path) const {
@@ -370,4 +504,5 @@ public:
 
 };
 
-
+// 4-connected moves and waiting, one time step each
+using SIPP = BasicSIPP<motion::CardinalWait>;
@@ -1,17 +1,21 @@
 #pragma once
+#include "cstr_table.hpp"
 #include "dynscens.hpp"
 #include "gridmap.hpp"
+#include "landmarks.hpp"
+#include "motion.hpp"
+#include "st_hash_set.hpp"
 #include <algorithm>
 #include <cassert>
 #include <format>
 #include <math.h>
 #include <queue>
-#include <set>
-#include <tuple>
 #include <vector>
 using namespace std;
 
-class STAstar {
+// `Motion` is a `motion::Model`, the moves and their durations
+template <typename Motion>
+class BasicSTAstar {
 public:
   using gridmap = movingai::gridmap;
   using Time = dynenv::Time;
@@ -59,22 +63,34 @@ public:
   }
   vector<Node> nodes;
   vector<int> parent;
-  set<tuple<vid, vid, Time>> frontier;
+  // (cell, t) pairs generated by the current search
+  st_hash_set frontier;
   ID bestID, curID;
   Cost best;
 
   int width, height;
   const gridmap &grid;
-  const dynenv::NodeCSTRs &cstrs;
+  // constraints, possibly shared with other solvers
+  shared_ptr<const dynenv::CSTRTable> table;
+  // optional differential heuristic, built with `gridmap::CARDINAL` moves;
+  // waiting only adds time, so static distances stay admissible
+  const Landmarks *landmarks = nullptr;
 
-  STAstar(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h)
-      : grid(g), cstrs(cs), width(w), height(h){};
+  BasicSTAstar(const gridmap &g, shared_ptr<const dynenv::CSTRTable> tb, int w, int h)
+      : frontier(w * h), width(w), height(h), grid(g), table(std::move(tb)){};
+
+  BasicSTAstar(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h)
+      : BasicSTAstar(g, make_shared<const dynenv::CSTRTable>(g, cs), w, h) {}
 
   inline vid id(const vid &x, const vid &y) const { return y * width + x; }
 
   inline double hVal(const STState &a, const vid &gx, const vid &gy) {
-		// using Manhattans distance in 4-connected grid
-    return abs(a.x - gx) + abs(a.y - gy);
+		// fewest time steps on an empty map under the motion model
+    double h = Motion::h(a.x, a.y, gx, gy);
+    if constexpr (Motion::dirs == gridmap::CARDINAL) {
+      return landmarks ? max(h, landmarks->h({a.x, a.y}, {gx, gy})) : h;
+    }
+    return h;
   }
 
   inline void init_search() {
@@ -88,27 +104,25 @@ public:
   }
 
   inline bool is_safe(const vid &x, const vid &y, const vid &t) {
-		// TODO: check whether (x, y, t) violate node constraints (cstrs) 
+		// TODO: check whether (x, y, t) violate node constraints (table) 
     if (x < 0 || x >= width || y < 0 || y >= height || t < 0)
       return false;
     if(grid.is_obstacle({x, y})) 
       return false; 
-    long node_id = y * width + x;
-    auto it = cstrs.find(node_id);
-    if(it == cstrs.end()) 
-      return true;
-    else {
-      for(auto intervals : it->second) {
-        if(intervals.is_in(t))
-          return false;
-      }
-      return true;
+    return table->is_safe(id(x, y), t);
+  }
+
+  // a move of `w` steps leaving (x, y) at `t` holds the cell until t + w - 1
+  inline bool can_hold(const vid &x, const vid &y, Time t, int w) {
+    for (Time k = t + 1; k < t + w; k++) {
+      if (!is_safe(x, y, k))
+        return false;
     }
-    return false;
+    return true;
   }
 
   bool frontierCheck(vid x, vid y, Time t) {
-    return frontier.find({x, y, t}) != frontier.end();
+    return frontier.contains(id(x, y), t);
   }
 
 	// Since `nodes` is dynamic container that get freqently resized
@@ -116,29 +130,16 @@ public:
   inline const Node &cur() const { return this->nodes.at(curID); }
 
   Time get_target_critical_time(vid target_gx, vid target_gy) const {
-      Time max_tr_at_target = -1;
-      long target_node_id = id(target_gx, target_gy);
-
-      auto it = cstrs.find(target_node_id);
-      if (it != cstrs.end()) {
-          if (it->second.empty()) {
-              return 0;
-          }
-          for (const auto& constraint : it->second) {
-              if (constraint.tr > max_tr_at_target) {
-                  max_tr_at_target = constraint.tr;
-              }
-          }
-      } else {
-          return 0;
-      }
-
-      return (max_tr_at_target == -1) ? 0 : max_tr_at_target;
+      return table->critical_time(id(target_gx, target_gy));
   }
 
   inline Cost run(int sx, int sy, int gx, int gy) {
 
     init_search();
+    // waiting never connects two components: the goal is unreachable
+    if (!grid.same_component({sx, sy}, {gx, gy}, Motion::connectivity)) {
+      return best;
+    }
     Time critical_time = get_target_critical_time(gx, gy);
 
 		// The priority_queue only store index of the data,
@@ -167,43 +168,171 @@ public:
         }
       }
 
-      // set the correct values  to model a 4-connected grid map:
-      // four motions: up, down, left, right
-      // each motion takes 1 time step
-      const static int nummoves = 5;
-      const static vid dx[] = {1, -1, 0, 0, 0};
-      const static vid dy[] = {0, 0, 1, -1, 0};
-      const static Cost w[] = {1, 1, 1, 1, 1};
-      int num = 0;
-      for (int i = 0; i < nummoves; i++) {
-        num = i;
-        vid nx = cur().v.x + dx[i];
-        vid ny = cur().v.y + dy[i];
-        Time nt = cur().v.t + w[i];
-        if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
-          continue;
-        }
+      // legality of the model's moves is a lookup in the precomputed
+      // neighbour mask, the loop is unrolled per model
+      Motion::for_each_move(grid.neighbour_mask({cur().v.x, cur().v.y}), [&](vid dx, vid dy, int w) {
+        vid nx = cur().v.x + dx;
+        vid ny = cur().v.y + dy;
+        Time nt = cur().v.t + w;
 
-        if (grid.is_obstacle({nx, ny}) || !is_safe(nx, ny, nt)) {
-          continue;
+        if (!is_safe(nx, ny, nt) || !can_hold(cur().v.x, cur().v.y, cur().v.t, w)) {
+          return;
         }
 				// Do we need this?
 				// What's the purpose of this pruning?
         if (frontierCheck(nx, ny, nt)) {
-           continue;
+           return;
         }
         ID nid = gen_node(nx, ny, nt);
 				// set g, h, parent value for the new node 
-        nodes[nid].g = cur().g + w[i];
+        nodes[nid].g = cur().g + w;
         nodes[nid].h = hVal(nodes[nid].v, gx, gy);
         parent[nid] = curID;
-        frontier.insert({nx, ny, nt});
+        frontier.insert(id(nx, ny), nt);
         q.push(nid);
-      }
+      });
     }
     return best;
   }
 
+  // `run` for many goals in one sweep. Moves take whole time steps, so the
+  // states reachable at time t follow from earlier ones alone and the
+  // search goes layer by layer in time. `run` never expands its goal, so
+  // a state carries the set of targets it is reachable for without
+  // passing their cell, one bit each, 64 targets per sweep. Target i is
+  // settled at the first layer after its critical time whose state at its
+  // cell holds bit i or, once no state holds bit i, at its last arrival,
+  // like `run` when its queue runs dry. States holding no live bit are
+  // dropped.
+  using Layer = vector<pair<vid, uint64_t>>; // (cell, targets), by cell
+  vector<vector<Layer>> sweeps;
+  vector<pair<vid, vid>> many_targets;
+  vector<Cost> many_cost;
+
+  vector<Cost> run_many(vid sx, vid sy, const vector<pair<vid, vid>> &targets) {
+    many_targets = targets;
+    many_cost.assign(targets.size(), -1);
+    sweeps.assign((targets.size() + 63) / 64, {});
+    for (size_t lo = 0; lo < targets.size(); lo += 64) {
+      sweep(sx, sy, lo, std::min(targets.size(), lo + 64));
+    }
+    return many_cost;
+  }
+
+  // path to the i-th target of the last `run_many`: walk the layers back
+  // through states holding bit i, never through the target's own cell
+  inline vector<STState> get_path_to(size_t i) {
+    vector<STState> res;
+    if (many_cost[i] == -1)
+      return res;
+    const vector<Layer> &layers = sweeps[i / 64];
+    uint64_t bit = 1ULL << (i % 64);
+    vid goal = id(many_targets[i].first, many_targets[i].second);
+    vid c = goal;
+    for (Time t = many_cost[i];;) {
+      res.push_back({c % width, c / width, t});
+      if (t == 0)
+        break;
+      Time from = -1;
+      // any move into c whose source holds bit i one move earlier
+      Motion::for_each_move(grid.neighbour_mask(c), [&](vid dx, vid dy, int w) {
+        vid px = c % width + dx, py = c / width + dy;
+        if (from != -1 || t < w || id(px, py) == goal || !can_hold(px, py, t - w, w))
+          return;
+        // moves are symmetric, (px, py) reaches c with the opposite one
+        const Layer &l = layers[t - w];
+        auto it = lower_bound(l.begin(), l.end(), make_pair(id(px, py), uint64_t(0)));
+        if (it != l.end() && it->first == id(px, py) && (it->second & bit)) {
+          c = id(px, py);
+          from = t - w;
+        }
+      });
+      if (from == -1)
+        return {};
+      t = from;
+    }
+    reverse(res.begin(), res.end());
+    return res;
+  }
+
+  void sweep(vid sx, vid sy, size_t lo, size_t hi) {
+    vector<Layer> &layers = sweeps[lo / 64];
+    // targets of the sweep at each cell
+    vector<uint64_t> at(width * height, 0);
+    vector<Time> critical(hi - lo);
+    vector<Cost> last(hi - lo, -1);
+    uint64_t live = 0;
+    for (size_t i = lo; i < hi; i++) {
+      auto [gx, gy] = many_targets[i];
+      // waiting never connects two components: the goal is unreachable
+      if (!grid.same_component({sx, sy}, {gx, gy}, Motion::connectivity))
+        continue;
+      at[id(gx, gy)] |= 1ULL << (i - lo);
+      live |= 1ULL << (i - lo);
+      critical[i - lo] = get_target_critical_time(gx, gy);
+    }
+    layers.assign(1, {});
+    if (live && is_safe(sx, sy, 0))
+      layers[0].push_back({id(sx, sy), live});
+
+    for (Time t = 0; live; t++) {
+      // moves land here from several layers: merge duplicates
+      Layer &cur = layers[t];
+      sort(cur.begin(), cur.end());
+      size_t n = 0;
+      for (size_t j = 0; j < cur.size(); j++) {
+        if (n > 0 && cur[n - 1].first == cur[j].first)
+          cur[n - 1].second |= cur[j].second;
+        else
+          cur[n++] = cur[j];
+      }
+      cur.resize(n);
+
+      uint64_t held = 0;
+      for (auto [c, m] : cur) {
+        held |= m;
+        for (uint64_t arrived = m & at[c] & live; arrived; arrived &= arrived - 1) {
+          int b = __builtin_ctzll(arrived);
+          if (t > critical[b]) {
+            many_cost[lo + b] = t;
+            live &= ~(1ULL << b);
+          } else {
+            last[b] = t;
+          }
+        }
+      }
+      // states still in flight to a later layer keep their bits alive
+      for (size_t k = t + 1; k < layers.size(); k++)
+        for (auto [c, m] : layers[k])
+          held |= m;
+      for (uint64_t gone = live & ~held; gone; gone &= gone - 1) {
+        int b = __builtin_ctzll(gone);
+        many_cost[lo + b] = last[b];
+        live &= ~(1ULL << b);
+      }
+      if (!live)
+        break;
+
+      for (auto [c, m] : cur) {
+        // a target's cell is a goal of `run`, never expanded for it
+        uint64_t out = m & ~at[c] & live;
+        if (!out)
+          continue;
+        vid x = c % width, y = c / width;
+        Motion::for_each_move(grid.neighbour_mask(c), [&](vid dx, vid dy, int w) {
+          vid nx = x + dx, ny = y + dy;
+          if (!is_safe(nx, ny, t + w) || !can_hold(x, y, t, w))
+            return;
+          if (layers.size() <= size_t(t + w))
+            layers.resize(t + w + 1);
+          layers[t + w].push_back({id(nx, ny), out});
+        });
+      }
+      if (layers.size() <= size_t(t + 1))
+        layers.resize(t + 2);
+    }
+  }
+
   inline vector<STState> get_path() {
     vector<STState> res;
     ID cid = bestID;
@@ -230,3 +359,6 @@ public:
     return true;
   }
 };
+
+// 4-connected moves and waiting, one time step each
+using STAstar = BasicSTAstar<motion::CardinalWait>;
@@ -0,0 +1,323 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "dynscens.hpp"
+#include "gridmap.hpp"
+
+namespace dynenv {
+
+// Node constraints of a scenario in CSR form, built once and shared by the
+// time-dependent solvers. For cell `c`:
+//  * raw: its constraints as given, sorted
+//  * unsafe: the same, merged (overlapping or touching intervals become one)
+//  * safe: the gaps between them up to HORIZON, none for obstacles;
+//    the k-th one has key k
+// so a solver can keep one flat array over all safe intervals and index
+// it with `safe_index(c, key)`.
+//
+// An eager table is built in parallel over blocks of rows when given more
+// than one thread: each block derives its cells into local buffers, block
+// sizes are prefix-summed into offsets, then every block copies its part
+// into place. The layout is the same for any number of threads.
+//
+// A lazy table derives the intervals of a cell the first time it is
+// looked at, so building it costs nothing per cell and a query pays only
+// for the cells it touches. It reads the constraints it was built from
+// until then, so they must outlive it, and lookups modify it: a lazy
+// table must not be shared between threads. Any table keeps reading the
+// grid for obstacles.
+//
+// Constraints can be added and removed cell by cell. Only the touched cell
+// is rederived; when it outgrows its range it moves to the end of the
+// array, and the arrays are compacted once half of them is unused. Safe
+// interval positions change in both cases, so solvers must not keep them
+// across searches (their round-stamped g-tables never do).
+class CSTRTable {
+public:
+  // no constraint reaches this time, the last safe interval ends before it
+  static constexpr Time HORIZON = std::numeric_limits<Time>::max() / 2;
+
+  // intervals of every cell in one flat array,
+  // cell `c` owns data[off[c] .. off[c] + len[c])
+  struct Ranges {
+    std::vector<int> off, len;
+    std::vector<Interval> data;
+    // entries no longer owned by any cell
+    size_t unused = 0;
+
+    inline const Interval *begin(int c) const { return data.data() + off[c]; }
+    inline const Interval *end(int c) const { return begin(c) + len[c]; }
+
+    // give cell `c` a new range at the end
+    inline void append(int c, const std::vector<Interval> &ivs) {
+      off[c] = data.size();
+      len[c] = ivs.size();
+      data.insert(data.end(), ivs.begin(), ivs.end());
+    }
+
+    void set(int c, const std::vector<Interval> &ivs) {
+      if (ivs.size() <= (size_t)len[c]) {
+        std::copy(ivs.begin(), ivs.end(), data.begin() + off[c]);
+        unused += len[c] - ivs.size();
+        len[c] = ivs.size();
+      } else {
+        unused += len[c];
+        append(c, ivs);
+      }
+      if (unused > data.size() / 2)
+        compact();
+    }
+
+    void compact() {
+      std::vector<Interval> packed;
+      packed.reserve(data.size() - unused);
+      for (size_t c = 0; c < off.size(); c++) {
+        int from = off[c];
+        off[c] = packed.size();
+        packed.insert(packed.end(), data.begin() + from, data.begin() + from + len[c]);
+      }
+      data.swap(packed);
+      unused = 0;
+    }
+  };
+
+  int num_cells;
+  bool lazy;
+  // derived cells are appended in the order they are first touched
+  mutable Ranges raw, unsafe, safe;
+
+  CSTRTable(const movingai::gridmap &grid, const NodeCSTRs &cstrs, bool lazy = false,
+            int threads = 1)
+      : num_cells(grid.width_ * grid.height_), lazy(lazy), grid(&grid), cstrs(&cstrs) {
+    for (Ranges *r : {&raw, &unsafe, &safe}) {
+      r->off.assign(num_cells, 0);
+      r->len.assign(num_cells, 0);
+    }
+    if (lazy)
+      ready.assign(num_cells, 0);
+    else
+      build(std::max(1, threads));
+  }
+
+  // whether no constraint of `cell` covers `t`
+  inline bool is_safe(int cell, Time t) const {
+    touch(cell);
+    const Interval *begin = unsafe.begin(cell), *end = unsafe.end(cell);
+    // last interval starting at or before t
+    auto it = std::upper_bound(begin, end, t, [](Time t, const Interval &iv) {
+      return t < iv.tl;
+    });
+    return it == begin || std::prev(it)->tr < t;
+  }
+
+  inline const Interval *safe_begin(int cell) const {
+    touch(cell);
+    return safe.begin(cell);
+  }
+  inline const Interval *safe_end(int cell) const {
+    touch(cell);
+    return safe.end(cell);
+  }
+  inline int num_safe(int cell) const {
+    touch(cell);
+    return safe.len[cell];
+  }
+
+  // key of the first safe interval of `cell` ending at or after `t`,
+  // `num_safe(cell)` if there is none; safe intervals are disjoint and
+  // sorted, so their ends are sorted too
+  inline int first_safe_from(int cell, Time t) const {
+    auto it = std::lower_bound(safe_begin(cell), safe_end(cell), t,
+                               [](const Interval &iv, Time t) { return iv.tr < t; });
+    return it - safe_begin(cell);
+  }
+
+  // position of the `key`-th safe interval of `cell`,
+  // below `num_slots()` until the next update
+  inline int safe_index(int cell, int key) const {
+    touch(cell);
+    return safe.off[cell] + key;
+  }
+  inline size_t num_slots() const { return safe.data.size(); }
+
+  // last time step `cell` is constrained at, 0 if never
+  inline Time critical_time(int cell) const {
+    touch(cell);
+    if (unsafe.len[cell] == 0)
+      return 0;
+    return std::max<Time>(0, unsafe.end(cell)[-1].tr);
+  }
+
+  // first time step past `end` and past every constraint, at most
+  // HORIZON: from there on every free cell stays safe. Unlike
+  // `critical_time` it derives no cell of a lazy table, cells not derived
+  // yet are read from their constraints as given
+  Time horizon(Time end) const {
+    Time last = std::max<Time>(end, 0);
+    for (int c = 0; c < num_cells; c++)
+      if ((!lazy || ready[c]) && unsafe.len[c] > 0)
+        last = std::max(last, unsafe.end(c)[-1].tr);
+    if (lazy)
+      for (const auto &[cell, ivs] : *cstrs)
+        if (cell >= 0 && cell < num_cells && !ready[cell])
+          for (const Interval &iv : ivs)
+            last = std::max(last, iv.tr);
+    return std::min(last, HORIZON - 1) + 1;
+  }
+
+  void add_constraint(int cell, const Interval &iv) {
+    touch(cell);
+    std::vector<Interval> ivs(raw.begin(cell), raw.end(cell));
+    ivs.insert(std::upper_bound(ivs.begin(), ivs.end(), iv, before), iv);
+    update(cell, ivs);
+  }
+
+  // remove one constraint equal to `iv`, false if `cell` has none
+  bool remove_constraint(int cell, const Interval &iv) {
+    touch(cell);
+    std::vector<Interval> ivs(raw.begin(cell), raw.end(cell));
+    auto it = std::find_if(ivs.begin(), ivs.end(), [&](const Interval &o) {
+      return o.tl == iv.tl && o.tr == iv.tr;
+    });
+    if (it == ivs.end())
+      return false;
+    ivs.erase(it);
+    update(cell, ivs);
+    return true;
+  }
+
+private:
+  const movingai::gridmap *grid;
+  const NodeCSTRs *cstrs;
+  // lazy tables only: whether a cell has been derived
+  mutable std::vector<char> ready;
+
+  inline bool is_obstacle(int c) const {
+    return grid->is_obstacle({c % grid->width_, c / grid->width_});
+  }
+
+  inline void touch(int c) const {
+    if (lazy && !ready[c])
+      derive_cell(c);
+  }
+
+  void derive_cell(int c) const {
+    ready[c] = 1;
+    std::vector<Interval> ivs, merged, gaps;
+    auto it = cstrs->find(c);
+    if (it != cstrs->end())
+      ivs = it->second;
+    std::sort(ivs.begin(), ivs.end(), before);
+    derive(ivs.data(), ivs.data() + ivs.size(), is_obstacle(c), merged, gaps);
+    raw.append(c, ivs);
+    unsafe.append(c, merged);
+    safe.append(c, gaps);
+  }
+
+  static inline bool before(const Interval &a, const Interval &b) {
+    return a.tl != b.tl ? a.tl < b.tl : a.tr < b.tr;
+  }
+
+  // run f(0) .. f(n - 1), one per thread
+  template <typename F> static void run_blocks(int n, F &&f) {
+    std::vector<std::thread> pool;
+    for (int i = 1; i < n; i++)
+      pool.emplace_back(f, i);
+    f(0);
+    for (auto &th : pool)
+      th.join();
+  }
+
+  void build(int threads) {
+    // raw constraints: count, prefix sum, fill (split over hash buckets)
+    for (const auto &[cell, ivs] : *cstrs)
+      if (cell >= 0 && cell < num_cells)
+        raw.len[cell] = ivs.size();
+    size_t total = 0;
+    for (int c = 0; c < num_cells; c++) {
+      raw.off[c] = total;
+      total += raw.len[c];
+    }
+    raw.data.resize(total);
+    size_t buckets = cstrs->bucket_count();
+    run_blocks(threads, [&](int t) {
+      for (size_t b = buckets * t / threads; b < buckets * (t + 1) / threads; b++)
+        for (auto it = cstrs->begin(b); it != cstrs->end(b); ++it)
+          if (it->first >= 0 && it->first < num_cells)
+            std::copy(it->second.begin(), it->second.end(), raw.data.begin() + raw.off[it->first]);
+    });
+
+    // merged and safe intervals: derive each row block into local
+    // buffers with local offsets, then shift them into place
+    int width = grid->width_, height = grid->height_;
+    std::vector<std::vector<Interval>> merged(threads), gaps(threads);
+    auto block = [&](int t) {
+      return std::make_pair(height * t / threads * width, height * (t + 1) / threads * width);
+    };
+    run_blocks(threads, [&](int t) {
+      auto [lo, hi] = block(t);
+      for (int c = lo; c < hi; c++) {
+        Interval *b = raw.data.data() + raw.off[c];
+        std::sort(b, b + raw.len[c], before);
+        unsafe.off[c] = merged[t].size();
+        safe.off[c] = gaps[t].size();
+        derive(b, b + raw.len[c], is_obstacle(c), merged[t], gaps[t]);
+        unsafe.len[c] = merged[t].size() - unsafe.off[c];
+        safe.len[c] = gaps[t].size() - safe.off[c];
+      }
+    });
+    std::vector<size_t> ubase(threads + 1, 0), sbase(threads + 1, 0);
+    for (int t = 0; t < threads; t++) {
+      ubase[t + 1] = ubase[t] + merged[t].size();
+      sbase[t + 1] = sbase[t] + gaps[t].size();
+    }
+    unsafe.data.resize(ubase[threads]);
+    safe.data.resize(sbase[threads]);
+    run_blocks(threads, [&](int t) {
+      auto [lo, hi] = block(t);
+      std::copy(merged[t].begin(), merged[t].end(), unsafe.data.begin() + ubase[t]);
+      std::copy(gaps[t].begin(), gaps[t].end(), safe.data.begin() + sbase[t]);
+      for (int c = lo; c < hi; c++) {
+        unsafe.off[c] += ubase[t];
+        safe.off[c] += sbase[t];
+      }
+    });
+  }
+
+  // append the merged constraints and the safe gaps of a cell,
+  // given its sorted constraints [b, e). A bound may be INT_MAX, so the
+  // comparisons subtract from the other side instead of adding to it
+  static void derive(const Interval *b, const Interval *e, bool obstacle,
+                     std::vector<Interval> &merged, std::vector<Interval> &gaps) {
+    size_t first = merged.size();
+    for (const Interval *iv = b; iv != e; iv++) {
+      if (merged.size() > first && iv->tl - 1 <= merged.back().tr)
+        merged.back().tr = std::max(merged.back().tr, iv->tr);
+      else
+        merged.push_back(*iv);
+    }
+    if (obstacle)
+      return;
+    Time last = -1;
+    for (size_t i = first; i < merged.size(); i++) {
+      if (merged[i].tl - 1 > last)
+        gaps.push_back({last + 1, merged[i].tl - 1});
+      last = std::max(last, merged[i].tr);
+    }
+    if (last < HORIZON - 1)
+      gaps.push_back({last + 1, HORIZON - 1});
+  }
+
+  void update(int cell, const std::vector<Interval> &ivs) {
+    std::vector<Interval> merged, gaps;
+    derive(ivs.data(), ivs.data() + ivs.size(), is_obstacle(cell), merged, gaps);
+    raw.set(cell, ivs);
+    unsafe.set(cell, merged);
+    safe.set(cell, gaps);
+  }
+};
+
+} // namespace dynenv
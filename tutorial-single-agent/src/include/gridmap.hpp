@@ -1,5 +1,8 @@
 #pragma once
 
+#include <bit>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -12,53 +15,142 @@ struct State {
   vid x, y;
 };
 
+// Binary gridmap file: this header followed by 8-byte aligned sections
+//  * packed rows: (height + 2) * padded_width / 64 words, the in-memory layout
+//  * neighbour masks: width * height bytes (if GMB_NMASK)
+//  * 4- then 8-connected component labels: width * height int32 each
+//    (if GMB_COMPONENTS)
+// so a map can be mmapped and used without parsing.
+struct gm_binary_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t width, height;
+  uint64_t padded_width;
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+constexpr char GMB_MAGIC[4] = {'G', 'M', 'B', 'N'};
+constexpr uint32_t GMB_VERSION = 1;
+constexpr uint32_t GMB_NMASK = 1;
+constexpr uint32_t GMB_COMPONENTS = 2;
+
 class gridmap {
 public:
+  // move table of an 8-connected grid, bit `i` of a neighbour mask
+  // refers to the move (dx[i], dy[i]); the first four moves are cardinal
+  static constexpr int dx[] = {1, -1, 0,  0, 1, -1,  1, -1};
+  static constexpr int dy[] = {0,  0, 1, -1, 1,  1, -1, -1};
+  static constexpr uint8_t CARDINAL = 0x0F;
+  static constexpr uint8_t ALL_MOVES = 0xFF;
+
   // init an empty map
   gridmap(int height, int width);
-  // init map based on an input file
+  // init map based on an input file, either an octile `.map`
+  // or a binary map written by `save_binary` (mmapped)
   gridmap(const string &filename);
 
-  inline vector<State> get_neighbours(State c) const {
-    // TODO: get neighbours of an 8-connected grid;
-    auto res = vector<State>{};
-    const int dx[] = {1, -1, 0,  0, 1, -1,  1, -1};
-    const int dy[] = {0,  0, 1, -1, 1,  1, -1, -1};
-    for (int i = 0; i < 8; ++i) {
-      int next_x = c.x + dx[i];
-      int next_y = c.y + dy[i];
-      if (next_x >= 0 && next_x < width_ && next_y >= 0 && next_y < height_) {
-        if (!is_obstacle({next_x, next_y})) {
-          if (i < 4) {
-            res.push_back({next_x, next_y});
-          } 
-          else {
-            if (!is_obstacle({c.x + dx[i], c.y}) && !is_obstacle({c.x, c.y + dy[i]})) {
-              res.push_back({next_x, next_y});
-            }
-          }
-        }
-      }
+  gridmap(const gridmap &other);
+  gridmap &operator=(const gridmap &other);
+
+  // write the map in the binary format, optionally with
+  // the neighbour masks and component labels
+  void save_binary(const string &filename, uint32_t flags = GMB_NMASK | GMB_COMPONENTS) const;
+
+  // call `f(State nxt, int dir)` for every legal move from `c`
+  // (no corner-cutting), restricted to the moves in `dirs`
+  template <typename F>
+  inline void for_each_neighbour(State c, F &&f,
+                                 uint8_t dirs = ALL_MOVES) const {
+    unsigned m = neighbour_mask(c) & dirs;
+    while (m) {
+      int i = countr_zero(m);
+      m &= m - 1;
+      f(State{c.x + dx[i], c.y + dy[i]}, i);
     }
+  }
 
+  inline vector<State> get_neighbours(State c) const {
+    auto res = vector<State>{};
+    for_each_neighbour(c, [&](State nxt, int) { res.push_back(nxt); });
     return res;
   };
 
-  // get the label associated with the coordinate (x, y)
-  inline bool is_obstacle(State c) const {
-    auto label = this->get_label(c);
-    return label == 1;
+  // precomputed successor mask of (x, y), bit `i` is set iff move `i` is legal
+  inline uint8_t neighbour_mask(State c) const {
+    return nmask[c.y * width_ + c.x];
   }
 
+  inline uint8_t neighbour_mask(vid id) const { return nmask[id]; }
+
+  // get the label associated with the coordinate (x, y)
+  // coordinates up to one cell outside the map are reported as obstacles
+  inline bool is_obstacle(State c) const { return this->get_label(c); }
+
   // set the label associated with the coordinate (x, y)
-  inline void set_label(State c, bool label) { db[c.y * width_ + c.x] = label; }
+  void set_label(State c, bool label);
+
+  inline bool get_label(State c) const {
+    size_t p = padded_id(c);
+    return !((bits[p >> 6] >> (p & 63)) & 1);
+  }
+
+  // label of the component containing `c` under 4- or 8-connected moves
+  // (8-connected respects corner-cutting), -1 for obstacles
+  inline int component(State c, int connectivity = 8) const {
+    return (connectivity == 4 ? comp4 : comp8)[c.y * width_ + c.x];
+  }
+
+  // whether `b` can be reached from `a` at all, a search between two
+  // different components would only exhaust its open list;
+  // labels go stale after `set_label` until `build_components` is called,
+  // and stale labels answer conservatively
+  inline bool same_component(State a, State b, int connectivity = 8) const {
+    if (!components_valid)
+      return true;
+    int ca = component(a, connectivity);
+    return ca != -1 && ca == component(b, connectivity);
+  }
 
-  inline bool get_label(State c) const { return db[c.y * width_ + c.x]; }
+  // (re)compute both component labellings
+  void build_components();
+
+  // content hash of the map (size and obstacles),
+  // used to detect stale preprocessed data
+  uint64_t hash() const;
 
   vid height_, width_;
   string filename;
-  // whether a location is an obstacle
-  vector<bool> db;
+
+private:
+  // rows are padded with a blocked border and rounded up to a whole number
+  // of 64-bit words, a set bit means the cell is traversable
+  inline size_t padded_id(State c) const {
+    return static_cast<size_t>(c.y + 1) * padded_width + (c.x + 1);
+  }
+
+  inline size_t num_words() const { return padded_width * (height_ + 2) / 64; }
+
+  void init_storage();
+  void load_binary(const string &filename);
+  void update_mask(State c);
+  void label_components(uint8_t dirs, vector<int> &comp) const;
+  // point the accessors at whichever buffers are owned
+  void bind();
+  // copy mapped tables into owned buffers before modifying them
+  void detach();
+
+  size_t padded_width;
+  // tables are read through these pointers, they refer either to the
+  // owned buffers below or into a read-only mapping of a binary map
+  const uint64_t *bits = nullptr;
+  const uint8_t *nmask = nullptr;
+  const int *comp4 = nullptr, *comp8 = nullptr;
+  vector<uint64_t> bits_buf;
+  vector<uint8_t> nmask_buf;
+  vector<int> comp4_buf, comp8_buf;
+  shared_ptr<const void> mapping;
+  bool components_valid = false;
 };
 
 } // namespace movingai
@@ -0,0 +1,297 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "gridmap.hpp"
+#include "cstr_table.hpp"
+#include "dynscens.hpp"
+#include "moving_target.hpp"
+#include "piecewise.hpp"
+using namespace std;
+
+// Earliest interception of one moving target from every (cell, departure
+// time), computed once by a backward sweep over time instead of one
+// forward search per query. E(c, t), the earliest time an agent standing
+// on c at t can stand on the target's cell, is t if the target is on c at
+// t, and otherwise the smallest E of the states (c', t + 1) it can move or
+// wait into; unsafe states have none. From the horizon on, past the last
+// constrained time step and the end of the trajectory, nothing changes any
+// more and E is t plus the static distance to the target's final cell,
+// which seeds the sweep.
+//
+// Within a safe interval E only grows with t and is either constant
+// (waiting for the target or for a cell to clear) or t plus a constant
+// (travelling), so each cell keeps E as `Piecewise` pieces and a query is
+// a binary search. Moves are those of `mt_SIPP`: 4-connected with
+// waiting, one step each, node constraints only. Unlike `mt_SIPP`, the
+// target can also be met by waiting for it, and the agent has to stay on
+// safe states the whole time.
+//
+// The sweep can also start at an earlier time `until`, with no
+// interception there. The table then only holds the interceptions before
+// `until`, still exactly, and `complete` says whether it holds them all.
+class InterceptionTable {
+public:
+    using gridmap = movingai::gridmap;
+    using Time = dynenv::Time;
+    using vid = movingai::vid;
+    static constexpr Time INFT = numeric_limits<Time>::max() / 4;
+
+    using Piece = dynenv::Piecewise::Piece;
+
+    struct STState {
+        vid x, y;
+        Time t;
+    };
+
+    int width, height;
+    const gridmap &grid;
+    shared_ptr<const dynenv::CSTRTable> table;
+    Time horizon = 0;
+    // where the sweep started, at most the horizon
+    Time until = 0;
+    // a cell's pieces come backwards in time, RUN to a block, most
+    // recent first; `first` of a cell is its block with the earliest
+    // pieces, down to time 0, and each block links to the one before it
+    static constexpr int RUN = 8;
+    struct Block {
+        Piece piece[RUN];
+        const Block *later;
+        int n;
+    };
+    deque<Block> blocks;
+    vector<Block *> first;
+    // static distance to the target's final cell, FAR if none
+    vector<int> far;
+
+    InterceptionTable(const gridmap &g, shared_ptr<const dynenv::CSTRTable> tb, int w, int h,
+                      const STStateTracker &tracker, Time limit = INFT)
+      : width(w), height(h), grid(g), table(std::move(tb)) {
+        build(tracker, limit);
+    }
+
+    // blocks link to each other, so a table can be moved but not copied
+    InterceptionTable(const InterceptionTable &) = delete;
+    InterceptionTable(InterceptionTable &&) = default;
+
+    inline vid id(const vid &x, const vid &y) const { return y * width + x; }
+
+    // whether the sweep started at the horizon, so that no interception
+    // is missing
+    bool complete() const { return until == horizon; }
+
+    // earliest interception from (x, y) at `t`, -1 if there is none, none
+    // before `until`, or (x, y) is unsafe at `t`
+    Time earliest(vid x, vid y, Time t) const {
+        vid c = id(x, y);
+        if (t < 0) {
+            return -1;
+        }
+        if (t >= horizon) {
+            return far[c] >= STStateTracker::FAR ? -1 : t + far[c];
+        }
+        if (t >= until) {
+            return -1;
+        }
+        const Block *b = first[c];
+        while (b->later && b->later->piece[RUN - 1].start <= t) {
+            b = b->later;
+        }
+        return dynenv::Piecewise::at(make_reverse_iterator(b->piece + b->n), make_reverse_iterator(b->piece), t);
+    }
+
+    // a path realising `earliest(x, y, t)`, one state per move in the
+    // style of `mt_SIPP::get_path` (waits are gaps in time), ending on the
+    // target; empty if there is none
+    vector<STState> path(vid x, vid y, Time t) const {
+        vector<STState> res;
+        Time e = earliest(x, y, t);
+        if (e == -1) {
+            return res;
+        }
+        res.push_back({x, y, t});
+        for (; t < e; t++) {
+            if (earliest(x, y, t + 1) == e) {
+                continue;
+            }
+            uint8_t mask = grid.neighbour_mask({x, y});
+            for (int d = 0; d < 4; d++) {
+                if ((mask & (1 << d)) && earliest(x + gridmap::dx[d], y + gridmap::dy[d], t + 1) == e) {
+                    x += gridmap::dx[d];
+                    y += gridmap::dy[d];
+                    res.push_back({x, y, t + 1});
+                    break;
+                }
+            }
+        }
+        if (res.back().t != e) {
+            res.push_back({x, y, e});
+        }
+        return res;
+    }
+
+private:
+    // E is swept over the grid padded with a column on the right and a row
+    // above and below, so that every cell has its neighbours at fixed
+    // offsets and a step is a straight loop
+    size_t pad(vid c) const { return static_cast<size_t>(c / width + 1) * (width + 1) + c % width; }
+
+    // a safety change met going backwards: a cell becomes unsafe at
+    // t = tl - 1 of one of its safe intervals, safe again at t = tr
+    struct Event {
+        Time t;
+        size_t p;
+        bool safe;
+    };
+
+    void build(const STStateTracker &tracker, Time limit) {
+        int cells = width * height;
+        far.assign(cells, STStateTracker::FAR);
+        blocks.clear();
+        first.assign(cells, nullptr);
+        if (tracker.states.empty()) {
+            horizon = until = 0;
+            return;
+        }
+        horizon = table->horizon(tracker.states.back().t);
+        until = min(limit, horizon);
+
+        // E at the horizon: every cell is safe from there on
+        auto last = tracker.getCoordinatesAtTime(horizon);
+        vector<vid> open;
+        if (!grid.is_obstacle({last.first, last.second})) {
+            far[id(last.first, last.second)] = 0;
+            open.push_back(id(last.first, last.second));
+        }
+        for (size_t k = 0; k < open.size(); k++) {
+            int d = far[open[k]] + 1;
+            grid.for_each_neighbour({open[k] % width, open[k] / width}, [&](movingai::State nxt, int) {
+                if (far[id(nxt.x, nxt.y)] == STStateTracker::FAR) {
+                    far[id(nxt.x, nxt.y)] = d;
+                    open.push_back(id(nxt.x, nxt.y));
+                }
+            }, gridmap::CARDINAL);
+        }
+        // all safety changes, latest first; those from `until` on are
+        // applied before the first step
+        vector<Event> events;
+        for (vid c = 0; c < cells; c++) {
+            if (grid.is_obstacle({c % width, c / width})) {
+                continue;
+            }
+            for (const auto *iv = table->safe_begin(c); iv != table->safe_end(c); iv++) {
+                if (iv->tl > 0) {
+                    events.push_back({iv->tl - 1, pad(c), false});
+                }
+                if (iv->tr < horizon - 1) {
+                    events.push_back({iv->tr, pad(c), true});
+                }
+            }
+        }
+        sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.t > b.t; });
+        // E never exceeds the horizon plus the longest way to the
+        // target's final cell; most tables fit 16 bits, which halves the
+        // memory a step goes through and lets SSE2 take min and max of
+        // eight cells at once
+        int longest = 0;
+        for (int d : far) {
+            if (d < STStateTracker::FAR) {
+                longest = max(longest, d);
+            }
+        }
+        if (horizon + longest < numeric_limits<int16_t>::max() / 4) {
+            sweep<int16_t>(tracker, events);
+        } else {
+            sweep<int32_t>(tracker, events);
+        }
+    }
+
+    // the backward sweep from `until` down to time 0, on values of type V
+    // with INFT scaled down to it. `cap` is INFT where the agent cannot
+    // stand at t (pads, obstacles, unsafe states) and 0 elsewhere, E(c, t)
+    // is at least it. `next` starts as E at `until`, none there if it is
+    // before the horizon
+    template <class V>
+    void sweep(const STStateTracker &tracker, const vector<Event> &events) {
+        using dynenv::Piecewise;
+        constexpr V inft = numeric_limits<V>::max() / 4;
+        int cells = width * height;
+        int pw = width + 1;
+        size_t pn = static_cast<size_t>(height + 2) * pw;
+        vector<V> next(pn, inft), cur(pn, inft), cap(pn, inft);
+        for (vid c = 0; c < cells; c++) {
+            if (grid.is_obstacle({c % width, c / width})) {
+                continue;
+            }
+            size_t p = pad(c);
+            next[p] = far[c] >= STStateTracker::FAR || until < horizon ? inft : horizon + far[c];
+            cap[p] = table->num_safe(c) == 0 ? inft : 0;
+        }
+
+        // every cell grows its piece backwards from t + 1, where it has
+        // the value in `next`; pieces starting at `until` are dropped.
+        // Whether a piece goes on is `Piecewise::continues` on the raw
+        // values (inft for NONE), written out so that a step over the
+        // whole grid is one vectorised loop that flags the cells whose
+        // piece ended. Pieces end on a few percent of the cell steps, so
+        // the flags are scanned eight at a time and only those cells
+        // close their piece into their block
+        vector<V> kind(pn, Piecewise::SINGLE);
+        vector<uint8_t> ended(pn + 8, 0);
+        auto close = [&](size_t p, Time start) {
+            Block *&b = first[(p / pw - 1) * width + p % pw];
+            if (!b || b->n == RUN) {
+                b = &blocks.emplace_back(Block{{}, b, 0});
+            }
+            b->piece[b->n++] = {start, next[p] == inft ? Piecewise::NONE : next[p], kind[p] == Piecewise::SLOPE};
+        };
+        auto ev = events.begin();
+        for (Time t = until - 1; t >= 0; t--) {
+            for (; ev != events.end() && ev->t >= t; ev++) {
+                cap[ev->p] = ev->safe ? 0 : inft;
+            }
+            auto pos = tracker.getCoordinatesAtTime(t);
+            size_t pt = pad(id(pos.first, pos.second));
+            V was = kind[pt];
+            auto *__restrict u = cur.data();
+            const auto *__restrict n = next.data();
+            const auto *__restrict cp = cap.data();
+            auto *__restrict k = kind.data();
+            auto *__restrict x = ended.data();
+            auto settle = [&](size_t p, V e) {
+                u[p] = e;
+                V flat = e == n[p];
+                V rise = (n[p] != inft) & (e == n[p] - 1);
+                V ok = (flat & k[p]) | (rise & (k[p] >> 1));
+                k[p] = ok ? V(Piecewise::SLOPE - flat) : k[p];
+                x[p] = ok ^ 1;
+            };
+            for (size_t p = pw; p < pn - pw; p++) {
+                settle(p, max(cp[p], min(min(min(n[p], n[p - 1]), min(n[p + 1], n[p - pw])), n[p + pw])));
+            }
+            if (!grid.is_obstacle({pos.first, pos.second}) && cap[pt] == 0) {
+                kind[pt] = was;
+                settle(pt, t);
+            }
+            for (size_t p = pw; p < pn - pw; p += 8) {
+                uint64_t w;
+                memcpy(&w, x + p, 8);
+                for (; w; w &= w - 1) {
+                    size_t q = p + countr_zero(w) / 8;
+                    if (t + 1 < until) {
+                        close(q, t + 1);
+                    }
+                    kind[q] = Piecewise::SINGLE;
+                }
+            }
+            swap(cur, next);
+        }
+        for (vid c = 0; c < cells; c++) {
+            close(pad(c), 0);
+        }
+    }
+};
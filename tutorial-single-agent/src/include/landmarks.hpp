@@ -0,0 +1,264 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <math.h>
+#include <queue>
+#include <string>
+#include <vector>
+#include "gridmap.hpp"
+using namespace std;
+using namespace movingai;
+
+// Differential heuristic: exact distance fields from K landmarks, so that
+// `max_k |d(L_k, a) - d(L_k, b)|` is a lower bound on d(a, b) by the
+// triangle inequality. Much tighter than octile/Manhattan around walls.
+//
+// Distances are taken under the moves `dirs` of the gridmap, unit cost
+// for cardinal and sqrt(2) for diagonal moves, and stored per cell as
+// round(d * scale) in uint16 whenever the largest distance fits, uint32
+// otherwise. With only cardinal moves scale is 1 and the table is exact.
+//
+// Landmarks are picked by farthest-point selection inside the largest
+// component. The table is cached in a sidecar `<mapfile>.lm4` / `.lm8`
+// and rebuilt when its header does not match the map or K.
+class Landmarks {
+
+  struct SidecarHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width, height;
+    uint64_t map_hash;
+    // requested and actual number of landmarks
+    uint32_t k, count;
+    uint32_t dirs, wide;
+    double scale;
+  };
+  static constexpr char MAGIC[4] = {'L', 'M', 'D', 'H'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr double SQRT2 = 1.41421356237;
+
+public:
+  static constexpr uint32_t NONE16 = numeric_limits<uint16_t>::max();
+  static constexpr uint32_t NONE32 = numeric_limits<uint32_t>::max();
+
+  const gridmap &grid;
+  int width, height;
+  // requested number of landmarks, `points` may hold fewer on tiny maps
+  int k;
+  uint8_t dirs;
+  vector<State> points;
+  // stored distance = round(d * scale)
+  double scale = 1;
+  // whether distances are stored in `d32` rather than `d16`
+  bool wide = false;
+  // cell-major: entry `id * points.size() + i` is the distance from landmark i
+  vector<uint16_t> d16;
+  vector<uint32_t> d32;
+  // whether the table was read from the sidecar rather than rebuilt
+  bool loaded = false;
+
+  Landmarks(const gridmap &grid, int k, uint8_t dirs = gridmap::ALL_MOVES)
+      : grid(grid), width(grid.width_), height(grid.height_), k(k), dirs(dirs) {
+    string sidecar = sidecar_path();
+    if (!sidecar.empty() && load(sidecar))
+      loaded = true;
+    else {
+      build();
+      if (!sidecar.empty())
+        save(sidecar);
+    }
+  }
+
+  inline int id(const State &c) const { return c.y * width + c.x; }
+
+  inline string sidecar_path() const {
+    if (grid.filename.empty())
+      return "";
+    return grid.filename + (dirs == gridmap::CARDINAL ? ".lm4" : ".lm8");
+  }
+
+  // lower bound on the distance between `a` and `b`
+  inline double h(const State &a, const State &b) const {
+    uint32_t best = wide ? diff(d32.data(), NONE32, a, b)
+                         : diff(d16.data(), NONE16, a, b);
+    // rounded distances can overshoot by one unit in total
+    if (dirs != gridmap::CARDINAL)
+      best = best > 0 ? best - 1 : 0;
+    return best / scale;
+  }
+
+  void build() {
+    size_t n = static_cast<size_t>(width) * height;
+    int conn = dirs == gridmap::CARDINAL ? 4 : 8;
+    // seed in the largest component, other components get no coverage
+    vector<int> size;
+    for (int i = 0; i < (int)n; i++) {
+      int c = grid.component({i % width, i / width}, conn);
+      if (c >= (int)size.size())
+        size.resize(c + 1, 0);
+      if (c >= 0)
+        size[c]++;
+    }
+    int largest = max_element(size.begin(), size.end()) - size.begin();
+    int seed = -1;
+    for (int i = 0; i < (int)n && seed == -1; i++)
+      if (!size.empty() && grid.component({i % width, i / width}, conn) == largest)
+        seed = i;
+
+    points.clear();
+    vector<vector<double>> fields;
+    vector<double> nearest(n, numeric_limits<double>::max());
+    vector<double> dist;
+    if (seed != -1) {
+      distance_field({seed % width, seed / width}, dist);
+      int next = farthest(dist, nearest);
+      while ((int)points.size() < k && next != -1) {
+        points.push_back({next % width, next / width});
+        fields.emplace_back();
+        distance_field(points.back(), fields.back());
+        for (size_t i = 0; i < n; i++)
+          nearest[i] = min(nearest[i], fields.back()[i]);
+        next = farthest(nearest, nearest);
+      }
+    }
+    int m = points.size();
+
+    double maxd = 0;
+    for (auto &f : fields)
+      for (double d : f)
+        if (d != numeric_limits<double>::max())
+          maxd = max(maxd, d);
+    scale = 1;
+    wide = false;
+    if (dirs != gridmap::CARDINAL) {
+      scale = min(1024.0, (NONE16 - 1) / max(maxd, 1.0));
+      // too coarse to be useful, keep the resolution and go wide
+      if (scale < 8) {
+        scale = 1024;
+        wide = true;
+      }
+    } else
+      wide = maxd >= NONE16;
+
+    d16.clear();
+    d32.clear();
+    if (wide)
+      d32.assign(n * m, NONE32);
+    else
+      d16.assign(n * m, NONE16);
+    for (int i = 0; i < m; i++)
+      for (size_t c = 0; c < n; c++) {
+        double d = fields[i][c];
+        if (d == numeric_limits<double>::max())
+          continue;
+        if (wide)
+          d32[c * m + i] = llround(d * scale);
+        else
+          d16[c * m + i] = llround(d * scale);
+      }
+  }
+
+  bool load(const string &fn) {
+    ifstream fin(fn, ios::binary);
+    if (!fin.is_open())
+      return false;
+    SidecarHeader hd;
+    if (!fin.read(reinterpret_cast<char *>(&hd), sizeof(hd)))
+      return false;
+    if (memcmp(hd.magic, MAGIC, 4) != 0 || hd.version != VERSION ||
+        hd.width != (uint32_t)width || hd.height != (uint32_t)height ||
+        hd.map_hash != grid.hash() || hd.k != (uint32_t)k || hd.dirs != dirs)
+      return false;
+    scale = hd.scale;
+    wide = hd.wide;
+    size_t n = static_cast<size_t>(width) * height * hd.count;
+    points.resize(hd.count);
+    if (!fin.read(reinterpret_cast<char *>(points.data()), hd.count * sizeof(State)))
+      return false;
+    if (wide) {
+      d32.resize(n);
+      return (bool)fin.read(reinterpret_cast<char *>(d32.data()), n * sizeof(uint32_t));
+    }
+    d16.resize(n);
+    return (bool)fin.read(reinterpret_cast<char *>(d16.data()), n * sizeof(uint16_t));
+  }
+
+  // the sidecar is only a cache, failing to write it is not an error
+  void save(const string &fn) const {
+    ofstream fout(fn, ios::binary | ios::trunc);
+    if (!fout.is_open())
+      return;
+    SidecarHeader hd;
+    memcpy(hd.magic, MAGIC, 4);
+    hd.version = VERSION;
+    hd.width = width;
+    hd.height = height;
+    hd.map_hash = grid.hash();
+    hd.k = k;
+    hd.count = points.size();
+    hd.dirs = dirs;
+    hd.wide = wide;
+    hd.scale = scale;
+    fout.write(reinterpret_cast<const char *>(&hd), sizeof(hd));
+    fout.write(reinterpret_cast<const char *>(points.data()), points.size() * sizeof(State));
+    if (wide)
+      fout.write(reinterpret_cast<const char *>(d32.data()), d32.size() * sizeof(uint32_t));
+    else
+      fout.write(reinterpret_cast<const char *>(d16.data()), d16.size() * sizeof(uint16_t));
+  }
+
+private:
+  template <typename T>
+  inline uint32_t diff(const T *d, uint32_t none, const State &a, const State &b) const {
+    int m = points.size();
+    const T *da = d + static_cast<size_t>(id(a)) * m;
+    const T *db = d + static_cast<size_t>(id(b)) * m;
+    uint32_t best = 0;
+    for (int i = 0; i < m; i++) {
+      if (da[i] == none || db[i] == none)
+        continue;
+      uint32_t v = da[i] > db[i] ? da[i] - db[i] : db[i] - da[i];
+      best = max(best, v);
+    }
+    return best;
+  }
+
+  // Dijkstra from `src` under `dirs`, unreachable cells stay at max()
+  void distance_field(const State &src, vector<double> &dist) const {
+    using QItem = pair<double, int>;
+    dist.assign(static_cast<size_t>(width) * height, numeric_limits<double>::max());
+    priority_queue<QItem, vector<QItem>, greater<QItem>> q;
+    dist[id(src)] = 0;
+    q.push({0, id(src)});
+    while (!q.empty()) {
+      auto [d, c] = q.top();
+      q.pop();
+      if (d > dist[c])
+        continue;
+      grid.for_each_neighbour({c % width, c / width}, [&](State nxt, int dir) {
+        double nd = d + (dir < 4 ? 1 : SQRT2);
+        if (nd < dist[id(nxt)]) {
+          dist[id(nxt)] = nd;
+          q.push({nd, id(nxt)});
+        }
+      }, dirs);
+    }
+  }
+
+  // reachable cell with the largest value in `dist` that is not yet a
+  // landmark (its `nearest` is not 0), or -1
+  int farthest(const vector<double> &dist, const vector<double> &nearest) const {
+    int best = -1;
+    for (int i = 0; i < (int)dist.size(); i++) {
+      if (dist[i] == numeric_limits<double>::max() || nearest[i] == 0)
+        continue;
+      if (best == -1 || dist[i] > dist[best])
+        best = i;
+    }
+    return best;
+  }
+};
@@ -0,0 +1,292 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <tuple>
+#include <vector>
+#include "gridmap.hpp"
+#include "cstr_table.hpp"
+#include "dynscens.hpp"
+using namespace std;
+
+// SIPP for closed-loop use, kept alive across replans in the style of
+// LPA*: every (cell, safe interval) state keeps g, its earliest arrival
+// as last expanded, and rhs, its earliest arrival given the g of its
+// predecessors. Arrival only grows with departure time, so rhs is a
+// one-step lookahead exactly as with static edge costs. A constraint
+// change rederives the states of one cell and puts the states whose rhs
+// it may change back in the open list; `replan` then repairs only the
+// inconsistent ones, so its cost follows the size of the change rather
+// than the size of the search.
+//
+// The start and the goal are fixed; `run` with another pair starts over.
+// Start states are reached at the start of their interval, as in `SIPP`.
+class LifelongSIPP {
+public:
+    using gridmap = movingai::gridmap;
+    using Time = dynenv::Time;
+    using vid = movingai::vid;
+    using Cost = int;
+    using ID = int;
+    static constexpr Cost INFT = numeric_limits<Cost>::max() / 4;
+
+    struct State {
+        vid cell;
+        dynenv::Interval iv;
+        Cost g = INFT, rhs = INFT;
+        // false once its cell was rederived, queue entries then go stale
+        bool alive = true;
+    };
+
+    // (min(g, rhs) + h, min(g, rhs)), the smaller one is expanded first
+    using Key = pair<Cost, Cost>;
+    using Entry = tuple<Key, ID>;
+
+    struct STState {
+        vid x, y;
+        Time t;
+    };
+
+    int width, height;
+    const gridmap &grid;
+    shared_ptr<dynenv::CSTRTable> table;
+    vector<State> states;
+    // states of each cell in interval order, empty until first touched
+    vector<vector<ID>> at;
+    vector<char> touched;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> open;
+    vid sx = -1, sy = -1, gx = -1, gy = -1;
+    // states expanded by the last `run` or `replan`
+    size_t expanded = 0;
+
+    // the solver keeps a private copy of the table to patch it
+    LifelongSIPP(const gridmap &g, const dynenv::CSTRTable &tb, int w, int h)
+      : width(w), height(h), grid(g), table(make_shared<dynenv::CSTRTable>(tb)) {}
+
+    LifelongSIPP(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h)
+      : width(w), height(h), grid(g), table(make_shared<dynenv::CSTRTable>(g, cs)) {}
+
+    inline vid id(const vid &x, const vid &y) const { return y * width + x; }
+
+    inline Cost hVal(vid cell) const {
+        // using Manhattans distance in 4-connected grid
+        return abs(cell % width - gx) + abs(cell / width - gy);
+    }
+
+    inline Key key(const State &s) const {
+        Cost k = min(s.g, s.rhs);
+        return {k + hVal(s.cell), k};
+    }
+
+    Cost run(vid sx, vid sy, vid gx, vid gy) {
+        this->sx = sx, this->sy = sy, this->gx = gx, this->gy = gy;
+        states.clear();
+        at.assign(width * height, {});
+        touched.assign(width * height, 0);
+        open = {};
+        expanded = 0;
+        // waiting never connects two components: the goal is unreachable
+        if (!grid.same_component({sx, sy}, {gx, gy}, 4)) {
+            return -1;
+        }
+        cell_states(id(gx, gy));
+        for (ID s : cell_states(id(sx, sy))) {
+            update(s);
+        }
+        return compute();
+    }
+
+    // repair the search after constraint changes
+    Cost replan() {
+        expanded = 0;
+        if (!grid.same_component({sx, sy}, {gx, gy}, 4)) {
+            return -1;
+        }
+        return compute();
+    }
+
+    void add_constraint(vid cell, const dynenv::Interval &iv) {
+        table->add_constraint(cell, iv);
+        rederive(cell);
+    }
+
+    bool remove_constraint(vid cell, const dynenv::Interval &iv) {
+        if (!table->remove_constraint(cell, iv)) {
+            return false;
+        }
+        rederive(cell);
+        return true;
+    }
+
+    // earliest arrival at the goal, -1 if there is none (yet)
+    Cost cost() {
+        ID b = best_goal();
+        return b == -1 || states[b].g >= INFT ? -1 : states[b].g;
+    }
+
+    // walk back from the goal through predecessors whose g explains
+    // the arrival, the state holds once `replan` returned
+    vector<STState> get_path() {
+        vector<STState> path;
+        ID s = best_goal();
+        if (s == -1 || states[s].g >= INFT) {
+            return path;
+        }
+        while (true) {
+            const State &cur = states[s];
+            path.push_back({cur.cell % width, cur.cell / width, cur.g});
+            if (cur.cell == id(sx, sy) && cur.g == cur.iv.tl) {
+                break;
+            }
+            ID from = -1;
+            for_each_pred(cur, [&](ID p, Cost arrival) {
+                if (from == -1 && arrival == cur.g) {
+                    from = p;
+                }
+            });
+            if (from == -1) {
+                break;
+            }
+            s = from;
+        }
+        reverse(path.begin(), path.end());
+        return path;
+    }
+
+private:
+    // states of a cell, created from the table on first touch
+    const vector<ID> &cell_states(vid c) {
+        if (!touched[c]) {
+            touched[c] = 1;
+            for (const auto *iv = table->safe_begin(c); iv != table->safe_end(c); iv++) {
+                at[c].push_back(states.size());
+                states.push_back({c, *iv});
+            }
+        }
+        return at[c];
+    }
+
+    // f(p, arrival at `s` from p) for every state p that can reach `s`:
+    // p leaves a neighbour cell no later than the end of its interval and
+    // `s` is entered at max(g(p) + 1, its start)
+    template <typename F> void for_each_pred(const State &s, F &&f) {
+        vid x = s.cell % width, y = s.cell / width;
+        uint8_t mask = grid.neighbour_mask({x, y});
+        for (int d = 0; d < 4; d++) {
+            if (!(mask & (1 << d))) {
+                continue;
+            }
+            vid n = id(x + gridmap::dx[d], y + gridmap::dy[d]);
+            if (!touched[n]) {
+                continue;
+            }
+            for (ID p : at[n]) {
+                const State &ps = states[p];
+                if (ps.g >= INFT) {
+                    continue;
+                }
+                Cost arrival = max(ps.g + 1, s.iv.tl);
+                if (arrival <= s.iv.tr && arrival - 1 <= ps.iv.tr) {
+                    f(p, arrival);
+                }
+            }
+        }
+    }
+
+    // every state `s` can move into, whatever its arrival time
+    template <typename F> void for_each_succ(const State &s, F &&f) {
+        vid x = s.cell % width, y = s.cell / width;
+        uint8_t mask = grid.neighbour_mask({x, y});
+        for (int d = 0; d < 4; d++) {
+            if (!(mask & (1 << d))) {
+                continue;
+            }
+            vid n = id(x + gridmap::dx[d], y + gridmap::dy[d]);
+            for (ID q : cell_states(n)) {
+                const auto &iv = states[q].iv;
+                if (iv.tl <= s.iv.tr + 1 && iv.tr >= s.iv.tl + 1) {
+                    f(q);
+                }
+            }
+        }
+    }
+
+    void update(ID s) {
+        State &st = states[s];
+        if (st.cell == id(sx, sy)) {
+            st.rhs = st.iv.tl;
+        } else {
+            Cost rhs = INFT;
+            for_each_pred(st, [&](ID, Cost arrival) { rhs = min(rhs, arrival); });
+            st.rhs = rhs;
+        }
+        if (st.g != st.rhs) {
+            open.push({key(st), s});
+        }
+    }
+
+    // the constraints of `c` changed: replace its states, then let them
+    // and their successors pick up their new predecessors
+    void rederive(vid c) {
+        if (sx == -1 || !touched[c]) {
+            return;
+        }
+        for (ID s : at[c]) {
+            states[s].alive = false;
+        }
+        at[c].clear();
+        touched[c] = 0;
+        for (ID s : cell_states(c)) {
+            update(s);
+        }
+        vid x = c % width, y = c / width;
+        uint8_t mask = grid.neighbour_mask({x, y});
+        for (int d = 0; d < 4; d++) {
+            vid n = id(x + gridmap::dx[d], y + gridmap::dy[d]);
+            if ((mask & (1 << d)) && touched[n]) {
+                for (ID s : at[n]) {
+                    update(s);
+                }
+            }
+        }
+    }
+
+    // goal state with the smallest key, -1 if the goal has no safe interval
+    ID best_goal() {
+        ID best = -1;
+        for (ID s : cell_states(id(gx, gy))) {
+            if (best == -1 || key(states[s]) < key(states[best])) {
+                best = s;
+            }
+        }
+        return best;
+    }
+
+    Cost compute() {
+        while (!open.empty()) {
+            auto [k, s] = open.top();
+            // dropped states, consistent ones and outdated keys
+            if (!states[s].alive || states[s].g == states[s].rhs || k != key(states[s])) {
+                open.pop();
+                continue;
+            }
+            ID b = best_goal();
+            if (b != -1 && !(k < key(states[b])) && states[b].g == states[b].rhs) {
+                break;
+            }
+            open.pop();
+            expanded++;
+            if (states[s].g > states[s].rhs) {
+                states[s].g = states[s].rhs;
+            } else {
+                states[s].g = INFT;
+                update(s);
+            }
+            // successors may be created below and move `states`
+            State cur = states[s];
+            for_each_succ(cur, [&](ID q) { update(q); });
+        }
+        return cost();
+    }
+};
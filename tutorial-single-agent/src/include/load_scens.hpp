@@ -6,11 +6,16 @@
 // @created: 08/08/2012
 //
 
+#include <bit>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace movingai {
 
@@ -46,36 +51,83 @@ public:
 
   inline movingai::gm_header get_header() { return this->header_; }
 
-  inline uint32_t get_num_tiles() { return this->map_.size(); }
-
-  inline char get_tile_at(unsigned int index) {
-    if (index >= this->map_.size()) {
-      std::cerr << "err; gm_parser::get_tile_at "
-                   "invalid index "
-                << index << std::endl;
-      exit(1);
-    }
-    return this->map_.at(index);
+  inline uint32_t get_num_tiles() {
+    return this->header_.height_ * this->header_.width_;
   }
 
+  // call `f(index)` for every traversable tile, in increasing index order;
+  // tiles are read straight from the file buffer, skipping whitespace
+  // 16 bytes at a time where SSE2 is available
+  template <typename F> void for_each_traversable(F &&f) const;
+
+  // size of the map file in bytes
+  inline size_t size() const { return this->buf_.size(); }
+
 private:
   gm_parser(const gm_parser &) {}
   gm_parser &operator=(const gm_parser &) { return *this; }
 
-  void parse_header(std::fstream &);
-  void parse_map(std::fstream &);
+  void parse_header();
+  void check_num_tiles(uint32_t index) const;
 
-  std::vector<char> map_;
+  // the whole map file, read at once
+  std::string buf_;
+  // offset of the first byte after the `map` keyword
+  size_t map_begin_;
   gm_header header_;
 };
 
+template <typename F> void gm_parser::for_each_traversable(F &&f) const {
+  const char *p = this->buf_.data() + this->map_begin_;
+  const char *end = this->buf_.data() + this->buf_.size();
+  uint32_t index = 0;
+  uint32_t max_tiles = this->header_.height_ * this->header_.width_;
+
+#ifdef __SSE2__
+  auto eq = [](__m128i v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+  while (p + 16 <= end && index + 16 <= max_tiles) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned ws = _mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(eq(v, ' '), eq(v, '\t')), _mm_or_si128(eq(v, '\n'), eq(v, '\r'))));
+    if (ws == 0) {
+      // 16 tiles, see `traversable` for the obstacle types
+      unsigned blocked = _mm_movemask_epi8(_mm_or_si128(
+          _mm_or_si128(_mm_or_si128(eq(v, 'S'), eq(v, 'W')), _mm_or_si128(eq(v, 'T'), eq(v, '@'))),
+          eq(v, 'O')));
+      for (unsigned free = ~blocked & 0xFFFF; free; free &= free - 1)
+        f(index + std::countr_zero(free));
+      index += 16;
+    } else {
+      // a line break inside the block, only keep the tiles
+      for (unsigned tiles = ~ws & 0xFFFF; tiles; tiles &= tiles - 1) {
+        if (traversable(p[std::countr_zero(tiles)]))
+          f(index);
+        index++;
+      }
+    }
+    p += 16;
+  }
+#endif
+
+  for (; p < end; p++) {
+    char c = *p;
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+      continue;
+    if (index < max_tiles && traversable(c))
+      f(index);
+    index++;
+  }
+  check_num_tiles(index);
+}
+
 class experiment {
 public:
   experiment(unsigned int sx, unsigned int sy, unsigned int gx, unsigned int gy,
              unsigned int mapwidth, unsigned int mapheight, double d,
              std::string m)
       : startx_(sx), starty_(sy), goalx_(gx), goaly_(gy), mapwidth_(mapwidth),
-        mapheight_(mapheight), distance_(d), map_(m), precision_(4) {}
+        mapheight_(mapheight), distance_(d), map_(m), precision_(4),
+        bucket_(0) {}
   ~experiment() {}
 
   inline unsigned int startx() { return startx_; }
@@ -100,12 +152,17 @@ public:
 
   inline void set_precision(int prec) { precision_ = prec; }
 
+  inline int bucket() { return bucket_; }
+
+  inline void set_bucket(int bucket) { bucket_ = bucket; }
+
 private:
   unsigned int startx_, starty_, goalx_, goaly_;
   unsigned int mapwidth_, mapheight_;
   double distance_;
   std::string map_;
   unsigned int precision_;
+  int bucket_;
 
   // no copy
   experiment(const experiment &other) {}
@@ -140,7 +197,7 @@ public:
   std::string last_file_loaded() { return sfile_; }
 
 private:
-  void load_v1_scenario(std::ifstream &infile);
+  void load_v1_scenario(const char *p, const char *end);
 
   std::vector<experiment *> experiments_;
   int version_;
@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include "gridmap.hpp"
+
+namespace motion {
+
+using movingai::gridmap;
+using movingai::vid;
+
+// Motion model of the time-dependent solvers, selected at compile time:
+// the moves of `gridmap` in `Dirs` (the same bits as its neighbour masks,
+// so diagonal moves follow its no-corner-cutting rule) and optionally
+// waiting in place. A cardinal move takes `Card` time steps and a
+// diagonal one `Diag`; an agent holds its cell until the last step of a
+// move, so a move of w steps is w - 1 waits followed by a one-step move.
+template <uint8_t Dirs, bool Wait, int Card = 1, int Diag = 1>
+struct Model {
+  static constexpr uint8_t dirs = Dirs;
+  static constexpr bool wait = Wait;
+  static constexpr int connectivity = Dirs == gridmap::CARDINAL ? 4 : 8;
+  static constexpr int nummoves = std::popcount(Dirs) + Wait;
+
+  struct Table {
+    vid dx[nummoves], dy[nummoves];
+    int w[nummoves];
+    // bit of the move in a neighbour mask, 0 for waiting
+    uint8_t bit[nummoves];
+  };
+
+  // moves in the order of `gridmap::dx/dy`, waiting last
+  static constexpr Table table = [] {
+    Table t{};
+    int n = 0;
+    for (int i = 0; i < 8; i++) {
+      if (Dirs & (1 << i)) {
+        t.dx[n] = gridmap::dx[i];
+        t.dy[n] = gridmap::dy[i];
+        t.w[n] = i < 4 ? Card : Diag;
+        t.bit[n++] = 1 << i;
+      }
+    }
+    if (Wait) {
+      t.dx[n] = t.dy[n] = 0;
+      t.w[n] = 1;
+      t.bit[n] = 0;
+    }
+    return t;
+  }();
+
+  // fewest time steps between two cells on an empty map: the diagonal
+  // part is done with diagonal moves when they are faster than two
+  // cardinal ones; admissible and consistent
+  static constexpr int h(vid ax, vid ay, vid bx, vid by) {
+    int x = std::abs(ax - bx), y = std::abs(ay - by);
+    if constexpr (Dirs == gridmap::CARDINAL)
+      return Card * (x + y);
+    else
+      return Card * (std::max(x, y) - std::min(x, y)) + std::min(Diag, 2 * Card) * std::min(x, y);
+  }
+
+  // call f(dx, dy, w) for every move legal under neighbour mask `mask`,
+  // unrolled over the table
+  template <typename F> static inline void for_each_move(uint8_t mask, F &&f) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+      ((!table.bit[I] || (mask & table.bit[I])
+            ? f(table.dx[I], table.dy[I], table.w[I])
+            : void()),
+       ...);
+    }(std::make_index_sequence<nummoves>{});
+  }
+};
+
+// 4-connected, as in the tutorial problem statement
+using Cardinal = Model<gridmap::CARDINAL, false>;
+// 4-connected with waiting, the default of the time-dependent solvers
+using CardinalWait = Model<gridmap::CARDINAL, true>;
+// 8-connected without corner-cutting, one step per move
+using Octile = Model<gridmap::ALL_MOVES, false>;
+using OctileWait = Model<gridmap::ALL_MOVES, true>;
+
+} // namespace motion
@@ -6,6 +6,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <bit>
 #include <utility>
 #include <algorithm>
 #include <cassert>
@@ -31,7 +32,60 @@ struct STState {
 };
 
 class STStateTracker {
+    // a dense index may span this many time steps per state
+    static constexpr size_t DENSE_FACTOR = 8;
+
+    Time t0 = 0, t1 = -1;
+    // position at every time step of [t0, t1] ...
+    std::vector<std::pair<vid, vid>> dense;
+    // ... or from each run start until the next one
+    std::vector<Time> run_t;
+    std::vector<std::pair<vid, vid>> run_pos;
+    // the timeline is cut into at most MAX_BLOCKS blocks of a power of
+    // two and at least BLOCK_MIN steps each, 13 blocks of 16 for the
+    // 200-step trackers
+    static constexpr Time MAX_BLOCKS = 16;
+    static constexpr Time BLOCK_MIN = 8;
+
+    // per block (major) and cell (minor), so that a search reads one
+    // plane at a time: the 4-connected distance to the nearest cell the
+    // target stands on during the block, and G of the next block (NONE
+    // after the last one), see `buildDistanceField`. Distances saturate
+    // below NONE, which stands for FAR
+    struct Entry {
+        uint16_t d, next;
+    };
+    static constexpr int NONE = std::numeric_limits<uint16_t>::max();
+
+    // the timeline [t0, t1] is cut into `nblocks` blocks of 2^`shift` steps
+    std::vector<Entry> field;
+    int shift = 0;
+    int nblocks = 0;
+    // size and `gridmap::hash` of the map the fields were built over,
+    // width -1 if none
+    vid field_width = -1, field_height = -1;
+    uint64_t field_hash = 0;
+
+    // multi-source BFS over `g` from `seeds`, `dist` has to hold FAR
+    static void bfs(const gridmap& g, std::vector<vid>& seeds, std::vector<int>& dist) {
+        for (vid c : seeds) {
+            dist[c] = 0;
+        }
+        for (size_t k = 0; k < seeds.size(); k++) {
+            int d = dist[seeds[k]] + 1;
+            g.for_each_neighbour({seeds[k] % g.width_, seeds[k] / g.width_}, [&](State nxt, int) {
+                vid j = nxt.y * g.width_ + nxt.x;
+                if (dist[j] == FAR) {
+                    dist[j] = d;
+                    seeds.push_back(j);
+                }
+            }, gridmap::CARDINAL);
+        }
+    }
+
 public:
+    static constexpr int FAR = std::numeric_limits<int>::max() / 4;
+
     std::vector<STState> states;
 
     STStateTracker() = default;
@@ -58,47 +112,155 @@ public:
         }
 
         infile.close();
-
-        // std::sort(states.begin(), states.end(), [](const STState& a, const STState& b) {
-        //     return a.t < b.t;
-        // });
+        buildIndex();
 
         return true;
     }
 
+    // index the trajectory by time; call it again after changing `states`.
+    // Timestamps are sorted first (stably, so of two states at the same
+    // time the later one still wins). When they cover their span densely
+    // enough, every time step gets its position and a lookup is a clamp
+    // and a load; otherwise consecutive states at the same cell are
+    // merged into runs and a lookup is a binary search over run starts.
+    void buildIndex() {
+        field.clear();
+        nblocks = 0;
+        field_width = -1;
+        dense.clear();
+        run_t.clear();
+        run_pos.clear();
+        if (states.empty()) {
+            return;
+        }
+        std::stable_sort(states.begin(), states.end(), [](const STState& a, const STState& b) {
+            return a.t < b.t;
+        });
+        t0 = states.front().t;
+        t1 = states.back().t;
+        if ((size_t)(t1 - t0) <= DENSE_FACTOR * states.size()) {
+            dense.resize(t1 - t0 + 1);
+            for (size_t i = 0; i < states.size(); i++) {
+                Time end = i + 1 < states.size() ? states[i + 1].t : t1 + 1;
+                std::fill(dense.begin() + (states[i].t - t0), dense.begin() + (end - t0),
+                          std::make_pair(states[i].x, states[i].y));
+            }
+            return;
+        }
+        for (size_t i = 0; i < states.size(); i++) {
+            auto p = std::make_pair(states[i].x, states[i].y);
+            if (!run_t.empty() && run_t.back() == states[i].t) {
+                run_pos.back() = p;
+            } else if (run_pos.empty() || run_pos.back() != p) {
+                run_t.push_back(states[i].t);
+                run_pos.push_back(p);
+            }
+        }
+    }
+
+    // position at `t`: the last state at or before it, the first state
+    // before the trajectory starts and the last one after it ends
     std::pair<vid, vid> getCoordinatesAtTime(Time t_input) const {
         if (states.empty()) {
             std::cerr << "Error: No states loaded." << std::endl;
             return std::make_pair(-1, -1);
         }
-
-        if (t_input >= states.back().t) {
-            return std::make_pair(states.back().x, states.back().y);
+        Time t = std::clamp(t_input, t0, t1);
+        if (!dense.empty()) {
+            return dense[t - t0];
         }
+        auto it = std::upper_bound(run_t.begin(), run_t.end(), t);
+        return run_pos[it - run_t.begin() - 1];
+    }
 
-        if (t_input < states.front().t) {
-            return std::make_pair(states.front().x, states.front().y);
+    // distance fields of the trajectory over `g`, one multi-source BFS
+    // per time block seeded from the cells the target stands on during
+    // the block: no interception can happen anywhere else, and a BFS
+    // distance changes by at most one per move. Cells in no seed's
+    // component stay at FAR. Each block b also gets G(b), a lower bound
+    // on min over blocks b' >= b of max(dist to block b', start of b' -
+    // start of b), through G(b) = min(dist to b, max(G(b + 1), block)).
+    void buildDistanceField(const gridmap& g) {
+        size_t cells = static_cast<size_t>(g.width_) * g.height_;
+        field_width = g.width_;
+        field_height = g.height_;
+        field_hash = g.hash();
+        if (states.empty()) {
+            nblocks = 0;
+            return;
         }
-
-        for (size_t i = states.size() - 1; i > 0; --i) {
-            if (states[i-1].t <= t_input && states[i].t > t_input) {
-                return std::make_pair(states[i-1].x, states[i-1].y);
+        Time span = t1 - t0 + 1;
+        Time block = std::bit_ceil<unsigned>(std::max((span + MAX_BLOCKS - 1) / MAX_BLOCKS, BLOCK_MIN));
+        shift = std::countr_zero<unsigned>(block);
+        nblocks = (span + block - 1) / block;
+        field.assign(cells * nblocks, {NONE, NONE});
+        std::vector<int> dist;
+        std::vector<vid> seeds;
+        size_t i = 0;
+        for (int b = 0; b < nblocks; b++) {
+            Time end = t0 + ((b + 1) << shift);
+            // the position at the block start, then every state inside it
+            auto p = getCoordinatesAtTime(t0 + (b << shift));
+            seeds.clear();
+            auto seed = [&](vid x, vid y) {
+                if (x >= 0 && x < g.width_ && y >= 0 && y < g.height_ && !g.is_obstacle({x, y})) {
+                    seeds.push_back(y * g.width_ + x);
+                }
+            };
+            seed(p.first, p.second);
+            for (; i < states.size() && states[i].t < end; i++) {
+                seed(states[i].x, states[i].y);
+            }
+            dist.assign(cells, FAR);
+            bfs(g, seeds, dist);
+            for (size_t c = 0; c < cells; c++) {
+                field[b * cells + c].d = dist[c] == FAR ? NONE : std::min(dist[c], NONE - 1);
             }
         }
-        return std::make_pair(states.front().x, states.front().y);
+        for (size_t c = 0; c < cells; c++) {
+            int next = NONE;
+            for (int b = nblocks - 1; b >= 0; b--) {
+                Entry& e = field[b * cells + c];
+                e.next = next;
+                next = std::min<int>(e.d, std::max<int>(next, block));
+            }
+        }
+    }
 
-        /*
-        auto it = std::upper_bound(states.begin(), states.end(), t_input,
-            [](Time val, const STState& state) {
-                return val < state.t;
-            });
+    // whether the distance fields were built over a map of the same size
+    // and obstacles as `g`; a map changed or replaced since needs new ones
+    inline bool hasDistanceField(const gridmap& g) const {
+        return field_width == g.width_ && field_height == g.height_ && field_hash == g.hash();
+    }
+
+    // distance from (x, y) to the nearest trajectory cell
+    inline int distanceToTrajectory(vid x, vid y) const {
+        int d = NONE;
+        if (nblocks == 0) {
+            return FAR;
+        }
+        size_t cells = static_cast<size_t>(field_width) * field_height;
+        for (size_t i = y * field_width + x; i < field.size(); i += cells) {
+            d = std::min<int>(d, field[i].d);
+        }
+        return d == NONE ? FAR : d;
+    }
 
-        if (it == states.begin()) {
-            return std::make_pair(states.front().x, states.front().y);
+    // lower bound on the time from (x, y) at `t` until the target can be
+    // met, min over t' >= t of max(dist((x, y), p(t')), t' - t): meet it
+    // during the block of t (before t0 the target waits at its first
+    // cell), or from the next block on, which starts at a known time.
+    // One load. Admissible, and consistent: a move or a wait changes
+    // either term by at most one, and on entering block b + 1 the bound
+    // becomes G(b + 1).
+    inline int interceptionBound(vid x, vid y, Time t) const {
+        if (nblocks == 0) {
+            return FAR;
         }
-        --it;
-        return std::make_pair(it->x, it->y);
-        */
+        int b = t <= t0 ? 0 : std::min<Time>((t - t0) >> shift, nblocks - 1);
+        Entry e = field[static_cast<size_t>(b) * field_width * field_height + y * field_width + x];
+        int h = std::min<int>(e.d, std::max<int>(e.next, t0 + ((b + 1) << shift) - t));
+        return h == NONE ? FAR : h;
     }
 
     void printStates() const {
@@ -111,27 +273,4 @@ public:
             std::cout << state.x << " " << state.y << " " << state.t << std::endl;
         }
     }
-
-    int getMinDistanceToPoint(vid target_x, vid target_y, Time t) const {
-        if (states.empty()) {
-            return std::numeric_limits<int>::max();
-        }
-
-        int min_distance = std::numeric_limits<int>::max();
-
-        for (const auto& state : states) {
-            int diff_x = state.x - target_x;
-            int abs_diff_x = std::abs(diff_x);
-
-            int diff_y = state.y - target_y;
-            int abs_diff_y = std::abs(diff_y);
-            
-            int current_distance = abs_diff_x + abs_diff_y;
-
-            if (current_distance < min_distance) {
-                min_distance = current_distance;
-            }
-        }
-        return min_distance;
-    }
 };
@@ -9,7 +9,9 @@
 #include <tuple>
 #include <map>
 #include "gridmap.hpp"
+#include "cstr_table.hpp"
 #include "dynscens.hpp"
+#include "piecewise.hpp"
 using namespace std;
 using namespace movingai;
 
@@ -94,17 +96,18 @@ public:
     vector<Node> nodes;
     vector<int> parent;
     //std::map<std::tuple<vid, vid, Time_interval>, Cost> state_g_values;
-    vector<vector<GVar>> gtable;
+    // one entry per safe interval, see `dynenv::CSTRTable::safe_index`
+    vector<GVar> gtable;
     ID bestID, curID;
     Cost best;
 
     int width, height;
     int global_round = 0;
     const gridmap &grid;
-    const dynenv::NodeCSTRs &cstrs;
-
-    std::map<vid, std::vector<Time_interval>> all_safe_intervals;
-    Time max_time = std::numeric_limits<int>::max() / 2;
+    // constraints and safe intervals, possibly shared with other solvers;
+    // `own` is set once this solver holds a private, modifiable copy
+    shared_ptr<const dynenv::CSTRTable> table;
+    shared_ptr<dynenv::CSTRTable> own;
 
     inline ID gen_node(int x, int y, Time_interval interval = {0, 0}, Cost g = 0, Cost h = 0, Time arrival_t = 0) {
         if (nodes.size() + 1 >= nodes.capacity()) {
@@ -118,29 +121,49 @@ public:
         return nodes.size() - 1;
     }
 
-    mt_SIPP(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h)
-      : grid(g), cstrs(cs), width(w), height(h){
-        init_all_safe_intervals();
-        gtable.resize(w * h);
-        //tracker.loadStatesFromFile(filename);
-        for (int i = 0; i < h * w; i++) {
-            if (cstrs.find(i) == cstrs.end())
-                gtable[i].resize(1);
-            else
-                gtable[i].resize(cstrs.at(i).size() + 1);
-        }
+    mt_SIPP(const gridmap &g, shared_ptr<const dynenv::CSTRTable> tb, int w, int h)
+      : grid(g), table(std::move(tb)), width(w), height(h){
+        gtable.resize(table->num_slots(), {0, 0});
       };
 
+    // `threads` > 1 builds the table in parallel, see `dynenv::CSTRTable`
+    mt_SIPP(const gridmap &g, const dynenv::NodeCSTRs &cs, int w, int h, int threads = 1)
+      : mt_SIPP(g, make_shared<dynenv::CSTRTable>(g, cs, false, threads), w, h) {
+        own = const_pointer_cast<dynenv::CSTRTable>(table);
+      }
+
+    // patch the constraints of one cell, only its safe intervals are
+    // rederived; a shared table is copied on the first update
+    void add_constraint(vid cell, const dynenv::Interval &iv) {
+        writable().add_constraint(cell, iv);
+    }
+
+    bool remove_constraint(vid cell, const dynenv::Interval &iv) {
+        return writable().remove_constraint(cell, iv);
+    }
+
     inline vid id(const vid &x, const vid &y) const { return y * width + x; }
 
-    inline double hVal(const vid &x, const vid &y, Time t, STStateTracker& tracker) {
-        return tracker.getMinDistanceToPoint(x, y, t);
-        
+    // time-aware bound on the time left until interception, read off
+    // the tracker's distance fields (built by `run`), see
+    // `STStateTracker::interceptionBound`
+    inline double hVal(const vid &x, const vid &y, Time t, const STStateTracker& tracker) const {
+        return tracker.interceptionBound(x, y, t);
+    }
+
+    // g-slot of a safe interval, lazy tables and updates add slots
+    inline GVar &slot(vid cid, int key) {
+        size_t i = table->safe_index(cid, key);
+        if (i >= gtable.size()) {
+            gtable.resize(std::max(i + 1, gtable.size() * 2), {0, 0});
+        }
+        return gtable[i];
     }
 
     inline Cost gval(vid cid, int key) {
-        if(gtable[cid][key].round == global_round) {
-            return gtable[cid][key].g;
+        const GVar &v = slot(cid, key);
+        if(v.round == global_round) {
+            return v.g;
         }
         else {
             return INFT;
@@ -157,53 +180,32 @@ public:
         global_round++;
     }
 
-    void init_all_safe_intervals() {
-        all_safe_intervals.clear();
-        for (int x = 0; x < width; ++x) {
-            for (int y = 0; y < height; ++y) {
-                vid c_id = y * width + x;
-                if (grid.is_obstacle({x, y})) {
-                    all_safe_intervals[c_id] = {};
-                    continue;
-                }
-
-                std::vector<Time_interval> unsafe_intervals;
-                auto constraints = cstrs.find(c_id);
-                if (constraints != cstrs.end()) {
-                    for (const auto& constraint : constraints->second) {
-                        unsafe_intervals.emplace_back(constraint.tl, constraint.tr, -1);
-                    }
-                }
-
-                std::sort(unsafe_intervals.begin(), unsafe_intervals.end());
-
-                std::vector<Time_interval> safe_intervals;
-                Time last_unsafe_end = -1;
-                int current_key = 0;
-                for (const auto& unsafe_interval : unsafe_intervals) {
-                    if (unsafe_interval.start > last_unsafe_end + 1) {
-                        safe_intervals.push_back({last_unsafe_end + 1, unsafe_interval.start - 1, current_key++});
-                    }
-                    last_unsafe_end = std::max(last_unsafe_end, unsafe_interval.end);
-                }
-
-                if (last_unsafe_end < max_time -1) {
-                    safe_intervals.push_back({last_unsafe_end + 1, max_time -1, current_key++});
-                }
-                else if (unsafe_intervals.empty()) {
-                    safe_intervals.push_back({0, max_time -1, current_key++});
-                }
-                all_safe_intervals[c_id] = safe_intervals;
-            }
+    dynenv::CSTRTable &writable() {
+        if (!own) {
+            own = make_shared<dynenv::CSTRTable>(*table);
+            table = own;
         }
+        return *own;
     }
 
     inline const Node &cur() const { return this->nodes.at(curID); }
 
 
 
+    // whether the target ever stands in the component of (sx, sy),
+    // read off the tracker's distance field
+    inline bool reachable(vid sx, vid sy, const STStateTracker& tracker) const {
+        return tracker.distanceToTrajectory(sx, sy) < STStateTracker::FAR;
+    }
+
     Cost run(vid sx, vid sy, Time agent_available_at_t, STStateTracker& tracker) {
         init_search();
+        if (!tracker.hasDistanceField(grid)) {
+            tracker.buildDistanceField(grid);
+        }
+        if (!reachable(sx, sy, tracker)) {
+            return best;
+        }
 
 		// The priority_queue only store index of the data,
 		// So we need a customized comparetor
@@ -215,19 +217,16 @@ public:
         best = bestID = -1;
         vid start_id = sy * width + sx;
 
-        auto it_start_intervals = all_safe_intervals.find(start_id);
-        if (it_start_intervals == all_safe_intervals.end() || it_start_intervals->second.empty()) {
+        if (table->num_safe(start_id) == 0) {
             return -1;
         }
-        const std::vector<Time_interval>& safe_intervals = it_start_intervals->second;
-        for (const auto& interval : safe_intervals) {
-          if (interval.end < agent_available_at_t) {
-            continue;
-          }
+        for (int key = table->first_safe_from(start_id, agent_available_at_t); key < table->num_safe(start_id); key++) {
+          const auto& iv = table->safe_begin(start_id)[key];
+          Time_interval interval(iv.tl, iv.tr, key);
           Time start_time = std::max(agent_available_at_t, interval.start);
           q.push(gen_node(sx, sy, interval, start_time, hVal(sx, sy, start_time, tracker), start_time));
           //state_g_values[{sx, sy, interval}] = interval.start;
-          gtable[id(sx, sy)][interval.key] = {start_time, global_round};
+          slot(start_id, key) = {start_time, global_round};
         }
 
         while (!q.empty()) {
@@ -252,22 +251,25 @@ public:
             const static vid dy[] = {0, 0, 1, -1, 0};
             const static Cost w[] = {1, 1, 1, 1, 1};
 
+            // the first four moves share the order of `gridmap::dx/dy`
+            uint8_t mask = grid.neighbour_mask({cur().state.x, cur().state.y});
             for(int i = 0; i < nummoves; i++) {
+                if(i < 4 && !(mask & (1 << i))) {
+                    continue;
+                }
                 vid nx = cur().state.x + dx[i];
                 vid ny = cur().state.y + dy[i];
                 Time nt = cur().arrival_time + w[i];
-                if(nx < 0 || nx >= width || ny < 0 || ny >= height || grid.is_obstacle({nx, ny})) {
-                    continue;
-                }
-                if(all_safe_intervals.find(ny * width + nx) == all_safe_intervals.end())
-                {
-                    continue;
-                }
-                const std::vector<Time_interval>& safe_intervals = all_safe_intervals.find(ny * width + nx)->second;
-                if(safe_intervals.empty()) {
-                    continue;
-                }
-                for(const auto& interval : safe_intervals) {
+                vid nid_cell = id(nx, ny);
+                // only intervals overlapping [nt, cur end + 1] can be entered:
+                // skip to the first one ending at or after nt, stop at the
+                // first one starting after the window
+                for(int key = table->first_safe_from(nid_cell, nt); key < table->num_safe(nid_cell); key++) {
+                    const auto& iv = table->safe_begin(nid_cell)[key];
+                    if(iv.tl > cur().state.interval.end + 1) {
+                        break;
+                    }
+                    Time_interval interval(iv.tl, iv.tr, key);
                     Time new_arrival_time = std::max(nt, interval.start);
                     if(cur().state.interval.end < new_arrival_time - 1) {
                         continue;
@@ -283,7 +285,7 @@ public:
                         continue;
                     }
                     ID nid = gen_node(nx, ny, interval, new_arrival_time, hVal(nx, ny, new_arrival_time, tracker), new_arrival_time);
-                    gtable[id(nx, ny)][interval.key] = {new_arrival_time, global_round};
+                    slot(nid_cell, key) = {new_arrival_time, global_round};
                     q.push(nid);
                     parent[nid] = curID;
                     //state_g_values[{nx, ny, interval}] = new_arrival_time;
@@ -300,6 +302,144 @@ public:
         Time t;
       };
 
+    // interception time as a function of departure time over a window,
+    // see `run_profile`; NONE (-1) where the target cannot be met
+    struct Profile : dynenv::Piecewise {
+        Time from = 0, to = -1;
+
+        // interception time departing at `d`, -1 if there is none or `d`
+        // is outside the window
+        Time arrival(Time d) const {
+            if (d < from || d > to) {
+                return -1;
+            }
+            return at(d);
+        }
+    };
+
+    // profile search: the earliest interception departing from (sx, sy)
+    // at every time in [from, to], in one forward time-layer sweep per
+    // safe interval of the start cell in the window. Like a time-expanded
+    // search, the sweep steps through every time step and every cell that
+    // holds a label then, rather than through safe intervals. States
+    // (cell, t) carry as label the latest departure of that interval
+    // reaching them; an earlier departure of the same interval can wait on
+    // the start cell until then, so a state reaches every departure of its
+    // interval up to its label, and the departures still unanswered are
+    // met at t as soon as the target's cell gets a label at or above them.
+    // Unlike `run`, the agent may wait for the target and stays on safe
+    // states throughout; departures at unsafe times get -1.
+    Profile run_profile(vid sx, vid sy, Time from, Time to, STStateTracker& tracker) {
+        Profile prof;
+        prof.from = from = std::max<Time>(from, 0);
+        prof.to = to;
+        if (to < from) {
+            return prof;
+        }
+        if (!tracker.hasDistanceField(grid)) {
+            tracker.buildDistanceField(grid);
+        }
+        vid start = id(sx, sy);
+        if (!reachable(sx, sy, tracker)) {
+            prof.push(from, -1);
+            return prof;
+        }
+        // nothing changes after the horizon, labels then only spread
+        Time horizon = table->horizon(tracker.states.back().t);
+
+        vector<Time> ld(width * height, -1), next_ld(width * height, -1);
+        vector<vid> active, next_active;
+        // per cell, the first safe interval ending at or after the time
+        // swept, moved forward as it advances; -1 until a sweep reaches
+        // the cell, and `seen` lists the cells it reached
+        vector<int> k(width * height, -1);
+        vector<vid> seen;
+        Time d = from;
+        for (int key = table->first_safe_from(start, from); key < table->num_safe(start) && d <= to; key++) {
+            const auto &iv = table->safe_begin(start)[key];
+            if (iv.tl > to) {
+                break;
+            }
+            for (; d < iv.tl; d++) {
+                prof.push(d, -1);
+            }
+            Time last = std::min<Time>(iv.tr, to);
+            for (vid c : active) {
+                ld[c] = -1;
+            }
+            active.clear();
+            for (vid c : seen) {
+                k[c] = -1;
+            }
+            seen.clear();
+            Time stop = std::max(horizon, last) + width * height;
+            for (Time t = d; d <= last && t <= stop; t++) {
+                if (t <= last) {
+                    if (ld[start] == -1) {
+                        active.push_back(start);
+                    }
+                    ld[start] = t;
+                }
+                auto p = tracker.getCoordinatesAtTime(t);
+                Time at = ld[id(p.first, p.second)];
+                for (; d <= std::min(at, last); d++) {
+                    prof.push(d, t);
+                }
+                // advance every label to t + 1, except those of departures
+                // answered already
+                Time most = -1;
+                for (vid c : active) {
+                    if (ld[c] < d) {
+                        continue;
+                    }
+                    vid x = c % width, y = c / width;
+                    auto spread = [&](vid n) {
+                        if (k[n] == -1) {
+                            k[n] = table->first_safe_from(n, t + 1);
+                            seen.push_back(n);
+                        }
+                        const auto *iv = table->safe_begin(n);
+                        while (k[n] < table->num_safe(n) && iv[k[n]].tr < t + 1) {
+                            k[n]++;
+                        }
+                        if (k[n] < table->num_safe(n) && iv[k[n]].tl <= t + 1) {
+                            if (next_ld[n] == -1) {
+                                next_active.push_back(n);
+                            }
+                            next_ld[n] = std::max(next_ld[n], ld[c]);
+                        }
+                    };
+                    spread(c);
+                    uint8_t mask = grid.neighbour_mask({x, y});
+                    for (int i = 0; i < 4; i++) {
+                        if (mask & (1 << i)) {
+                            spread(id(x + gridmap::dx[i], y + gridmap::dy[i]));
+                        }
+                    }
+                    most = std::max(most, ld[c]);
+                }
+                for (vid c : active) {
+                    ld[c] = -1;
+                }
+                swap(ld, next_ld);
+                swap(active, next_active);
+                next_active.clear();
+                // no departure is left alive, or past both the horizon
+                // and the window the best label is already on the target
+                if ((active.empty() && t >= last) || (t >= std::max(horizon, last) && at == most)) {
+                    break;
+                }
+            }
+            for (; d <= last; d++) {
+                prof.push(d, -1);
+            }
+        }
+        for (; d <= to; d++) {
+            prof.push(d, -1);
+        }
+        return prof;
+    }
+
     std::vector<STState> get_path() const {
         std::vector<STState> path;
         if (bestID == -1) {
@@ -317,23 +457,12 @@ public:
     }
 
     inline bool is_safe(const vid &x, const vid &y, const vid &t) const {
-		// TODO: check whether (x, y, t) violate node constraints (cstrs) 
+		// TODO: check whether (x, y, t) violate node constraints (table) 
         if (x < 0 || x >= width || y < 0 || y >= height || t < 0)
             return false;
         if(grid.is_obstacle({x, y})) 
             return false; 
-        long node_id = y * width + x;
-        auto it = cstrs.find(node_id);
-        if(it == cstrs.end()) 
-            return true;
-        else {
-            for(auto intervals : it->second) {
-                if(intervals.is_in(t))
-                    return false;
-            }
-            return true;
-        }
-        return false;
+        return table->is_safe(id(x, y), t);
     }
 
     inline bool validate(const vector<STState> &path) const {
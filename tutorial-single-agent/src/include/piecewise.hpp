@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include "dynscens.hpp"
+
+namespace dynenv {
+
+// A function of time kept as pieces that are either constant or grow by
+// one per step, as interception times are: waiting keeps them, departing
+// later while travelling delays them one for one. NONE marks times with
+// no value. Pieces are built one time step at a time, forwards or
+// backwards, and a step extends the piece at hand whenever `continues`
+// allows, so a piece is only started where the function changes course.
+// Lookups are a binary search over piece starts.
+struct Piecewise {
+    static constexpr Time NONE = -1;
+
+    // v + (slope ? t - start : 0) from `start` up to the next piece
+    struct Piece {
+        Time start, v;
+        bool slope;
+
+        Time at(Time t) const {
+            return v == NONE ? NONE : v + (slope ? t - start : 0);
+        }
+    };
+
+    std::vector<Piece> pieces;
+
+    // value at `t` of the pieces [begin, end), `t` at or after the first
+    // start
+    template <class It>
+    static Time at(It begin, It end, Time t) {
+        return std::prev(std::upper_bound(begin, end, t, [](Time t, const Piece &p) {
+            return t < p.start;
+        }))->at(t);
+    }
+
+    Time at(Time t) const {
+        return at(pieces.begin(), pieces.end(), t);
+    }
+
+    // which ways a piece may still go: one step long it may turn out
+    // constant or growing, longer it is one of them
+    enum Kind : int32_t { CONSTANT = 1, SLOPE = 2, SINGLE = CONSTANT | SLOPE };
+
+    // whether a piece of kind `k` whose value is `from` at one end can
+    // take `to` one step past it, after (`dir` 1) or before (`dir` -1);
+    // if so, `k` is its kind then
+    static bool continues(Kind &k, Time from, Time to, int dir) {
+        int flat = to == from;
+        int rise = from != NONE && to != NONE && to == from + dir;
+        if (!((flat & k) | (rise & (k >> 1)))) {
+            return false;
+        }
+        k = flat ? CONSTANT : SLOPE;
+        return true;
+    }
+
+    // sets the value at `t`, one step past the last one set
+    void push(Time t, Time v) {
+        if (!pieces.empty()) {
+            Piece &b = pieces.back();
+            Kind k = b.slope ? SLOPE : t == b.start + 1 ? SINGLE : CONSTANT;
+            if (continues(k, b.at(t - 1), v, 1)) {
+                b.slope = k == SLOPE;
+                return;
+            }
+        }
+        pieces.push_back({t, v, false});
+    }
+};
+
+} // namespace dynenv
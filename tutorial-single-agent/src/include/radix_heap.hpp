@@ -0,0 +1,75 @@
+#pragma once
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Monotone radix heap: a min-priority queue over uint64_t keys that requires
+// every pushed key to be >= the last popped one, as in A* with a consistent
+// heuristic. Bucket `i > 0` holds keys whose highest bit differing from
+// `last` is bit i-1, so a push is O(1) and every element moves to a lower
+// bucket at most 64 times over its lifetime.
+template <typename V> class radix_heap {
+  using Item = pair<uint64_t, V>;
+
+  vector<Item> buckets[65];
+  uint64_t last = 0;
+  size_t n = 0;
+
+  static inline int bucket_of(uint64_t key, uint64_t last) {
+    return key == last ? 0 : 64 - countl_zero(key ^ last);
+  }
+
+public:
+  inline bool empty() const { return n == 0; }
+
+  inline size_t size() const { return n; }
+
+  inline void clear() {
+    for (auto &b : buckets)
+      b.clear();
+    last = 0;
+    n = 0;
+  }
+
+  inline void push(uint64_t key, const V &v) {
+    assert(key >= last);
+    buckets[bucket_of(key, last)].emplace_back(key, v);
+    n++;
+  }
+
+  // key of the minimum, must not be empty
+  inline uint64_t top_key() {
+    refill();
+    return last;
+  }
+
+  // remove and return the minimum, must not be empty
+  inline Item pop() {
+    refill();
+    Item it = buckets[0].back();
+    buckets[0].pop_back();
+    n--;
+    return it;
+  }
+
+private:
+  // make sure bucket 0 holds the current minimum keys
+  inline void refill() {
+    if (!buckets[0].empty())
+      return;
+    int i = 1;
+    while (buckets[i].empty())
+      i++;
+    uint64_t lo = numeric_limits<uint64_t>::max();
+    for (auto &it : buckets[i])
+      lo = min(lo, it.first);
+    last = lo;
+    for (auto &it : buckets[i])
+      buckets[bucket_of(it.first, last)].push_back(it);
+    buckets[i].clear();
+  }
+};
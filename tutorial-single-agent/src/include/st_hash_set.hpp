@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <vector>
+using namespace std;
+
+// Open-addressing hash set of (cell, time) pairs, used as the closed list
+// of the time-expanded searches. Linear probing over a power-of-two table
+// of 16-byte slots; slots are round-stamped like the solvers' g-tables so
+// `clear` is O(1), and the table doubles whenever it gets half full, so
+// its size follows the number of states the horizon actually generates.
+class st_hash_set {
+  struct Slot {
+    uint64_t key;
+    int round;
+  };
+
+  vector<Slot> slots;
+  size_t mask;
+  size_t n = 0;
+  int round = 1;
+
+  static inline uint64_t key_of(int cell, int t) {
+    return (uint64_t(uint32_t(cell)) << 32) | uint32_t(t);
+  }
+
+  // splitmix64 finaliser, consecutive times must not share a probe run
+  static inline size_t hash(uint64_t k) {
+    k ^= k >> 30;
+    k *= 0xbf58476d1ce4e5b9ULL;
+    k ^= k >> 27;
+    k *= 0x94d049bb133111ebULL;
+    k ^= k >> 31;
+    return k;
+  }
+
+public:
+  st_hash_set(size_t capacity = 1024) {
+    size_t cap = 16;
+    while (cap < 2 * capacity)
+      cap <<= 1;
+    slots.assign(cap, {0, 0});
+    mask = cap - 1;
+  }
+
+  inline size_t size() const { return n; }
+
+  inline void clear() {
+    n = 0;
+    if (round == numeric_limits<int>::max()) {
+      for (auto &s : slots)
+        s.round = 0;
+      round = 0;
+    }
+    round++;
+  }
+
+  inline bool contains(int cell, int t) const {
+    uint64_t k = key_of(cell, t);
+    for (size_t i = hash(k) & mask;; i = (i + 1) & mask) {
+      if (slots[i].round != round)
+        return false;
+      if (slots[i].key == k)
+        return true;
+    }
+  }
+
+  // returns false if (cell, t) was already in the set
+  inline bool insert(int cell, int t) {
+    if (2 * (n + 1) > slots.size())
+      grow();
+    return place(key_of(cell, t));
+  }
+
+private:
+  inline bool place(uint64_t k) {
+    for (size_t i = hash(k) & mask;; i = (i + 1) & mask) {
+      if (slots[i].round != round) {
+        slots[i] = {k, round};
+        n++;
+        return true;
+      }
+      if (slots[i].key == k)
+        return false;
+    }
+  }
+
+  void grow() {
+    vector<Slot> old;
+    old.swap(slots);
+    int live = round;
+    slots.assign(old.size() * 2, {0, 0});
+    mask = slots.size() - 1;
+    round = 1;
+    n = 0;
+    for (auto &s : old)
+      if (s.round == live)
+        place(s.key);
+  }
+};
@@ -1,20 +1,281 @@
 #include "gridmap.hpp"
 #include "load_scens.hpp"
 
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 using namespace movingai;
 
-gridmap::gridmap(vid h, vid w) {
-  this->db.resize(h * w);
-  fill(this->db.begin(), this->db.end(), false);
+gridmap::gridmap(vid h, vid w) : height_(h), width_(w) {
+  init_storage();
+  for (vid y = 0; y < h; y++)
+    for (vid x = 0; x < w; x++) {
+      size_t p = padded_id({x, y});
+      bits_buf[p >> 6] |= uint64_t(1) << (p & 63);
+    }
+  for (vid y = 0; y < h; y++)
+    for (vid x = 0; x < w; x++)
+      update_mask({x, y});
+  build_components();
 };
 
-gridmap::gridmap(const string &filename) {
+gridmap::gridmap(const string &filename) : filename(filename) {
+  char magic[4] = {0};
+  ifstream(filename, ios::binary).read(magic, 4);
+  if (memcmp(magic, GMB_MAGIC, 4) == 0) {
+    load_binary(filename);
+    return;
+  }
+
   gm_parser parser(filename);
   this->height_ = parser.get_header().height_;
   this->width_ = parser.get_header().width_;
-  this->db.resize(this->height_ * this->width_);
-  for (vid i = 0; i < this->db.size(); i++) {
-    auto c = parser.get_tile_at(i);
-    this->db[i] = traversable(c) ? 0 : 1;
+  init_storage();
+  parser.for_each_traversable([&](uint32_t i) {
+    size_t p = padded_id({vid(i % width_), vid(i / width_)});
+    bits_buf[p >> 6] |= uint64_t(1) << (p & 63);
+  });
+  for (vid y = 0; y < height_; y++)
+    for (vid x = 0; x < width_; x++)
+      update_mask({x, y});
+  build_components();
+}
+
+gridmap::gridmap(const gridmap &other) { (*this) = other; }
+
+gridmap &gridmap::operator=(const gridmap &other) {
+  height_ = other.height_;
+  width_ = other.width_;
+  filename = other.filename;
+  padded_width = other.padded_width;
+  // mapped tables are shared, owned ones are copied
+  bits = other.bits;
+  nmask = other.nmask;
+  comp4 = other.comp4;
+  comp8 = other.comp8;
+  bits_buf = other.bits_buf;
+  nmask_buf = other.nmask_buf;
+  comp4_buf = other.comp4_buf;
+  comp8_buf = other.comp8_buf;
+  mapping = other.mapping;
+  components_valid = other.components_valid;
+  bind();
+  return *this;
+}
+
+void gridmap::init_storage() {
+  padded_width = (static_cast<size_t>(width_) + 2 + 63) / 64 * 64;
+  bits_buf.assign(num_words(), 0);
+  nmask_buf.assign(static_cast<size_t>(width_) * height_, 0);
+  bind();
+}
+
+void gridmap::bind() {
+  if (!bits_buf.empty())
+    bits = bits_buf.data();
+  if (!nmask_buf.empty())
+    nmask = nmask_buf.data();
+  if (!comp4_buf.empty())
+    comp4 = comp4_buf.data();
+  if (!comp8_buf.empty())
+    comp8 = comp8_buf.data();
+}
+
+void gridmap::detach() {
+  if (!mapping)
+    return;
+  size_t n = static_cast<size_t>(width_) * height_;
+  if (bits_buf.empty())
+    bits_buf.assign(bits, bits + num_words());
+  if (nmask_buf.empty())
+    nmask_buf.assign(nmask, nmask + n);
+  if (comp4_buf.empty())
+    comp4_buf.assign(comp4, comp4 + n);
+  if (comp8_buf.empty())
+    comp8_buf.assign(comp8, comp8 + n);
+  bind();
+  mapping.reset();
+}
+
+// size of a binary map section, rounded up to keep the next one aligned
+static size_t section_size(size_t bytes) { return (bytes + 7) / 8 * 8; }
+
+void gridmap::load_binary(const string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    std::cerr << "err; gridmap::load_binary "
+                 "cannot open map file: " << filename << std::endl;
+    exit(1);
+  }
+  size_t len = st.st_size;
+  void *addr = len >= sizeof(gm_binary_header)
+                   ? mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0)
+                   : MAP_FAILED;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "err; gridmap::load_binary "
+                 "cannot map file: " << filename << std::endl;
+    exit(1);
+  }
+  mapping = shared_ptr<const void>(addr, [len](const void *p) {
+    munmap(const_cast<void *>(p), len);
+  });
+
+  const auto *hd = static_cast<const gm_binary_header *>(addr);
+  if (hd->version != GMB_VERSION) {
+    std::cerr << "err; binary map " << filename << " has version "
+              << hd->version << ", expected " << GMB_VERSION << std::endl;
+    exit(1);
+  }
+  height_ = hd->height;
+  width_ = hd->width;
+  padded_width = hd->padded_width;
+  size_t n = static_cast<size_t>(width_) * height_;
+  size_t expected = sizeof(gm_binary_header) + section_size(num_words() * 8);
+  if (hd->flags & GMB_NMASK)
+    expected += section_size(n);
+  if (hd->flags & GMB_COMPONENTS)
+    expected += 2 * section_size(n * sizeof(int));
+  if (padded_width != (static_cast<size_t>(width_) + 2 + 63) / 64 * 64 ||
+      len < expected) {
+    std::cerr << "err; binary map " << filename << " is truncated or corrupt"
+              << std::endl;
+    exit(1);
   }
+
+  const char *p = static_cast<const char *>(addr) + sizeof(gm_binary_header);
+  bits = reinterpret_cast<const uint64_t *>(p);
+  p += section_size(num_words() * 8);
+  if (hd->flags & GMB_NMASK) {
+    nmask = reinterpret_cast<const uint8_t *>(p);
+    p += section_size(n);
+  } else {
+    nmask_buf.assign(n, 0);
+    bind();
+    for (vid y = 0; y < height_; y++)
+      for (vid x = 0; x < width_; x++)
+        update_mask({x, y});
+  }
+  if (hd->flags & GMB_COMPONENTS) {
+    comp4 = reinterpret_cast<const int *>(p);
+    p += section_size(n * sizeof(int));
+    comp8 = reinterpret_cast<const int *>(p);
+    components_valid = true;
+  } else
+    build_components();
+}
+
+void gridmap::save_binary(const string &filename, uint32_t flags) const {
+  ofstream fout(filename, ios::binary | ios::trunc);
+  if (!fout.is_open()) {
+    std::cerr << "err; gridmap::save_binary "
+                 "cannot open file: " << filename << std::endl;
+    exit(1);
+  }
+  // stale labels are not worth storing
+  if (!components_valid)
+    flags &= ~GMB_COMPONENTS;
+  gm_binary_header hd;
+  memcpy(hd.magic, GMB_MAGIC, 4);
+  hd.version = GMB_VERSION;
+  hd.width = width_;
+  hd.height = height_;
+  hd.padded_width = padded_width;
+  hd.flags = flags;
+  hd.reserved = 0;
+
+  const char zeros[8] = {0};
+  auto section = [&](const void *data, size_t bytes) {
+    fout.write(static_cast<const char *>(data), bytes);
+    fout.write(zeros, section_size(bytes) - bytes);
+  };
+  size_t n = static_cast<size_t>(width_) * height_;
+  fout.write(reinterpret_cast<const char *>(&hd), sizeof(hd));
+  section(bits, num_words() * 8);
+  if (flags & GMB_NMASK)
+    section(nmask, n);
+  if (flags & GMB_COMPONENTS) {
+    section(comp4, n * sizeof(int));
+    section(comp8, n * sizeof(int));
+  }
+}
+
+void gridmap::update_mask(State c) {
+  uint8_t m = 0;
+  for (int i = 0; i < 8; i++) {
+    if (is_obstacle({c.x + dx[i], c.y + dy[i]}))
+      continue;
+    // no corner-cutting: both cardinal cells of a diagonal move must be free
+    if (i >= 4 && (is_obstacle({c.x + dx[i], c.y}) ||
+                   is_obstacle({c.x, c.y + dy[i]})))
+      continue;
+    m |= 1 << i;
+  }
+  nmask_buf[c.y * width_ + c.x] = m;
+}
+
+void gridmap::set_label(State c, bool label) {
+  detach();
+  size_t p = padded_id(c);
+  if (label)
+    bits_buf[p >> 6] &= ~(uint64_t(1) << (p & 63));
+  else
+    bits_buf[p >> 6] |= uint64_t(1) << (p & 63);
+  components_valid = false;
+  // only the 3x3 block around `c` can see a different successor set
+  for (int y = c.y - 1; y <= c.y + 1; y++)
+    for (int x = c.x - 1; x <= c.x + 1; x++)
+      if (x >= 0 && x < width_ && y >= 0 && y < height_)
+        update_mask({x, y});
+}
+
+void gridmap::build_components() {
+  label_components(CARDINAL, comp4_buf);
+  label_components(ALL_MOVES, comp8_buf);
+  bind();
+  components_valid = true;
+}
+
+void gridmap::label_components(uint8_t dirs, vector<int> &comp) const {
+  comp.assign(static_cast<size_t>(width_) * height_, -1);
+  vector<vid> open;
+  int label = 0;
+  for (vid i = 0; i < width_ * height_; i++) {
+    if (comp[i] != -1 || is_obstacle({i % width_, i / width_}))
+      continue;
+    // breadth-first flood fill along the legal moves
+    comp[i] = label;
+    open.assign(1, i);
+    for (size_t k = 0; k < open.size(); k++) {
+      State c{open[k] % width_, open[k] / width_};
+      for_each_neighbour(c, [&](State nxt, int) {
+        vid j = nxt.y * width_ + nxt.x;
+        if (comp[j] == -1) {
+          comp[j] = label;
+          open.push_back(j);
+        }
+      }, dirs);
+    }
+    label++;
+  }
+}
+
+uint64_t gridmap::hash() const {
+  // FNV-1a over the dimensions and the packed rows
+  uint64_t h = 14695981039346656037ULL;
+  auto mix = [&](uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+      h ^= (v >> (i * 8)) & 0xFF;
+      h *= 1099511628211ULL;
+    }
+  };
+  mix(width_);
+  mix(height_);
+  for (size_t i = 0; i < num_words(); i++)
+    mix(bits[i]);
+  return h;
 }
@@ -1,6 +1,9 @@
 #include "load_scens.hpp"
 
+#include <cctype>
+#include <charconv>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 bool movingai::traversable(char c)
@@ -22,19 +25,46 @@ bool movingai::traversable(char c)
   return res;
 }
 
+// read a whole file into `buf` with a single read
+static bool read_file(const std::string& filename, std::string& buf)
+{
+	std::ifstream fin(filename.c_str(), std::ios::in | std::ios::binary);
+	if(!fin.is_open())
+	{
+		return false;
+	}
+	fin.seekg(0, std::ios::end);
+	buf.resize(fin.tellg());
+	fin.seekg(0, std::ios::beg);
+	fin.read(buf.data(), buf.size());
+	return true;
+}
+
+// skip whitespace, then return the next whitespace separated token
+static std::string_view next_token(const char*& p, const char* end)
+{
+	while(p < end && std::isspace(static_cast<unsigned char>(*p)))
+	{
+		p++;
+	}
+	const char* begin = p;
+	while(p < end && !std::isspace(static_cast<unsigned char>(*p)))
+	{
+		p++;
+	}
+	return std::string_view(begin, p - begin);
+}
+
 movingai::gm_parser::gm_parser(const std::string& filename)
 {
-	std::fstream mapfs(filename.c_str(), std::fstream::in);
-	if(!mapfs.is_open())
+	if(!read_file(filename, this->buf_))
 	{
 		std::cerr << "err; gm_parser::gm_parser "
 			"cannot open map file: "<<filename << std::endl;
 		exit(1);
 	}
 
-	this->parse_header(mapfs);
-	this->parse_map(mapfs);
-	mapfs.close();
+	this->parse_header();
 }
 
 movingai::gm_parser::~gm_parser()
@@ -42,20 +72,22 @@ movingai::gm_parser::~gm_parser()
 }
 
 void 
-movingai::gm_parser::parse_header(std::fstream& mapfs)
+movingai::gm_parser::parse_header()
 {
+	const char* p = this->buf_.data();
+	const char* end = p + this->buf_.size();
+
 	// read header fields
 	std::unordered_map<std::string, std::string> contents;
 	for(int i=0; i < 3; i++)
 	{
-		std::string hfield, hvalue;
-		mapfs >> hfield;
-		if(mapfs.good())
+		std::string_view hfield = next_token(p, end);
+		if(!hfield.empty())
 		{
-			mapfs >> hvalue;
-			if(mapfs.good())
+			std::string_view hvalue = next_token(p, end);
+			if(!hvalue.empty())
 			{
-				contents[hfield] = hvalue;
+				contents[std::string(hfield)] = std::string(hvalue);
 			}
 			else
 			{
@@ -93,47 +125,18 @@ movingai::gm_parser::parse_header(std::fstream& mapfs)
 		exit(1);
 	}
 
-}
-
-void 
-movingai::gm_parser::parse_map(std::fstream& mapfs)
-{
-	std::string hfield;
-	mapfs >> hfield;
-	if(hfield.compare("map") != 0)
+	if(next_token(p, end) != "map")
 	{
 		std::cerr << "err; map load failed. missing 'map' keyword." 
 			<< std::endl;
 	}
+	this->map_begin_ = p - this->buf_.data();
+}
 
-	// read map data
-	int index = 0;
-	int max_tiles = this->header_.height_*this->header_.width_;
-	while(true)
-	{
-		char c = mapfs.get();	
-		if( !mapfs.good() )
-		{
-			// eof
-			break;
-		}
-
-		if(c == ' ' || c == '\t' || c == '\n' || c == '\r')
-		{
-			// skip whitespace
-			continue;
-		}
-
-		if(index >= max_tiles)
-		{
-			index++;
-			continue;
-		}
-
-		this->map_.push_back(c);
-		index++;
-	}
-
+void 
+movingai::gm_parser::check_num_tiles(uint32_t index) const
+{
+	uint32_t max_tiles = this->header_.height_*this->header_.width_;
 	if(index != max_tiles)
 	{
 		std::cerr << "err; expected " << max_tiles
@@ -159,67 +162,78 @@ movingai::scenario_manager::~scenario_manager()
 void 
 movingai::scenario_manager::load_scenario(const std::string& filelocation)
 {
-	std::ifstream infile;
-	infile.open(filelocation.c_str(),std::ios::in);
-
-	if(!infile.good())
+	std::string buf;
+	if(!read_file(filelocation, buf))
 	{
 		std::cerr << "err; scenario_manager::load_scenario "
 		<< "Invalid scenario file: "<<filelocation << std::endl;
-		infile.close();
 		exit(1);
 	}
 
 	sfile_ = filelocation;
-
+	const char* p = buf.data();
+	const char* end = p + buf.size();
 
 	// Check if a version number is given
 	float version=0;
-	std::string first;
-	infile >> first;
-	if(first != "version")
+	const char* first_end = p;
+	if(next_token(first_end, end) == "version")
 	{
-		version = 0.0;
-		infile.seekg(0,std::ios::beg);
+		p = first_end;
+		std::string_view token = next_token(p, end);
+		version = strtof(std::string(token).c_str(), 0);
 	}
 
-	infile >> version;
 	if(version == 1.0 || version == 0)
 	{
-		load_v1_scenario(infile);
+		load_v1_scenario(p, end);
 	}
 	else
 	{
 		std::cerr << "err; scenario_manager::load_scenario "
 			<< " scenario has invalid version number. \n";
-		infile.close();
 		exit(1);
 	}
-
-	infile.close();
 }
 
 // V1.0 is the version officially supported by HOG
 void 
-movingai::scenario_manager::load_v1_scenario(std::ifstream& infile)
+movingai::scenario_manager::load_v1_scenario(const char* p, const char* end)
 {
+	auto parse_int = [&](int& v)
+	{
+		std::string_view token = next_token(p, end);
+		auto res = std::from_chars(token.data(), token.data() + token.size(), v);
+		return !token.empty() && res.ec == std::errc();
+	};
+
 	int sizeX = 0, sizeY = 0; 
 	int bucket;
-	std::string map;  
 	int xs, ys, xg, yg;
-	std::string dist;
 
-	while(infile>>bucket>>map>>sizeX>>sizeY>>xs>>ys>>xg>>yg>>dist)
+	while(parse_int(bucket))
 	{
-		double dbl_dist = strtod(dist.c_str(),0);
+		std::string_view map = next_token(p, end);
+		if(map.empty() || !parse_int(sizeX) || !parse_int(sizeY) || !parse_int(xs)
+				|| !parse_int(ys) || !parse_int(xg) || !parse_int(yg))
+		{
+			break;
+		}
+		std::string_view dist = next_token(p, end);
+		double dbl_dist = 0;
+		if(std::from_chars(dist.data(), dist.data() + dist.size(), dbl_dist).ec != std::errc())
+		{
+			break;
+		}
 		experiments_.push_back(
-				new experiment(xs,ys,xg,yg,sizeX,sizeY,dbl_dist,map));
+				new experiment(xs,ys,xg,yg,sizeX,sizeY,dbl_dist,std::string(map)));
 
 		int precision = 0;
-		if(dist.find(".") != std::string::npos)
+		if(dist.find(".") != std::string_view::npos)
 		{
 			precision = dist.size() - (dist.find(".")+1);
 		}
 		experiments_.back()->set_precision(precision);
+		experiments_.back()->set_bucket(bucket);
 	}
 }
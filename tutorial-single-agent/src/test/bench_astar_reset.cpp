@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "Astar.hpp"
+#include "gridmap.hpp"
+#include "load_scens.hpp"
+using namespace std;
+
+// Astar used to reset its g-table and the parent array (O(W*H)) before
+// every query, it now bumps a round counter instead. Report, for the
+// shortest and the longest buckets of a scenario file, the mean query
+// time next to the cost of the reset it no longer pays.
+int main(int argc, char** argv) {
+	// ./bench_astar_reset <mapfile> <scenfile> [repeats]
+	if (argc < 3) {
+		cerr << "Usage: ./bench_astar_reset <mapfile> <scenfile> [repeats]" << endl;
+		return 1;
+	}
+	movingai::gridmap g(argv[1]);
+	movingai::scenario_manager scenmrg;
+	scenmrg.load_scenario(argv[2]);
+	int repeats = argc > 3 ? atoi(argv[3]) : 10;
+	size_t cells = static_cast<size_t>(g.width_) * g.height_;
+
+	int max_bucket = 0;
+	for (unsigned i = 0; i < scenmrg.num_experiments(); i++)
+		max_bucket = max(max_bucket, scenmrg.get_experiment(i)->bucket());
+	int span = max(1, (max_bucket + 1) / 10);
+
+	Astar solver(g, g.width_, g.height_);
+	vector<int> parent;
+	vector<double> eager_g;
+	vector<int> eager_parent;
+	const char* names[2] = {"short", "long"};
+	for (int group = 0; group < 2; group++) {
+		double search = 0, reset = 0;
+		int queries = 0;
+		for (unsigned i = 0; i < scenmrg.num_experiments(); i++) {
+			auto expr = scenmrg.get_experiment(i);
+			bool in_group = group == 0 ? expr->bucket() < span : expr->bucket() > max_bucket - span;
+			if (!in_group)
+				continue;
+			for (int r = 0; r < repeats; r++) {
+				auto t0 = chrono::steady_clock::now();
+				solver.run(expr->startx(), expr->starty(), expr->goalx(), expr->goaly(), parent);
+				auto t1 = chrono::steady_clock::now();
+				eager_g.assign(cells, numeric_limits<double>::max());
+				eager_parent.assign(cells, -1);
+				auto t2 = chrono::steady_clock::now();
+				search += chrono::duration<double>(t1 - t0).count();
+				reset += chrono::duration<double>(t2 - t1).count();
+				queries++;
+			}
+		}
+		if (queries == 0)
+			continue;
+		printf("%-5s queries: %d, round-stamped query %.6fs, eager reset %.6fs, eager query %.6fs (%.2fx)\n",
+				names[group], queries, search / queries, reset / queries,
+				(search + reset) / queries, (search + reset) / max(search, 1e-12));
+	}
+}
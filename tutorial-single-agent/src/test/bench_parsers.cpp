@@ -0,0 +1,81 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "load_scens.hpp"
+using namespace std;
+
+// byte by byte reference: what gm_parser did before reading in bulk
+static size_t naive_parse_map(const string& fn) {
+	fstream fs(fn.c_str(), fstream::in);
+	string field, value;
+	for (int i = 0; i < 3; i++)
+		fs >> field >> value;
+	fs >> field;
+	size_t free = 0;
+	while (true) {
+		char c = fs.get();
+		if (!fs.good())
+			break;
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+			continue;
+		free += movingai::traversable(c);
+	}
+	return free;
+}
+
+// operator>> reference: what scenario_manager did before
+static size_t naive_parse_scen(const string& fn) {
+	ifstream fin(fn);
+	string first, map, dist;
+	float version;
+	fin >> first >> version;
+	int bucket, w, h, xs, ys, xg, yg;
+	size_t n = 0;
+	while (fin >> bucket >> map >> w >> h >> xs >> ys >> xg >> yg >> dist) {
+		n += strtod(dist.c_str(), 0) > 0;
+	}
+	return n;
+}
+
+template <typename F>
+static void bench(const string& name, const string& fn, int repeats, F&& f) {
+	double mb = filesystem::file_size(fn) / 1e6;
+	size_t sink = 0;
+	auto tstart = chrono::steady_clock::now();
+	for (int i = 0; i < repeats; i++)
+		sink += f();
+	double t = chrono::duration<double>(chrono::steady_clock::now() - tstart).count();
+	printf("%-12s %8.2f MB/s  (%d x %.3f MB in %fs, checksum %zu)\n",
+			name.c_str(), mb * repeats / t, repeats, mb, t, sink);
+}
+
+int main(int argc, char** argv) {
+	// ./bench_parsers <mapfile> <scenfile> [repeats]
+	if (argc < 3) {
+		cerr << "Usage: ./bench_parsers <mapfile> <scenfile> [repeats]" << endl;
+		return 1;
+	}
+	string mapfile = string(argv[1]);
+	string scenfile = string(argv[2]);
+	int repeats = argc > 3 ? atoi(argv[3]) : 20;
+
+	bench("map naive", mapfile, repeats, [&]() { return naive_parse_map(mapfile); });
+	bench("map bulk", mapfile, repeats, [&]() {
+		movingai::gm_parser parser(mapfile);
+		size_t free = 0;
+		parser.for_each_traversable([&](uint32_t) { free++; });
+		return free;
+	});
+	bench("scen naive", scenfile, repeats, [&]() { return naive_parse_scen(scenfile); });
+	bench("scen bulk", scenfile, repeats, [&]() {
+		movingai::scenario_manager scenmgr;
+		scenmgr.load_scenario(scenfile);
+		size_t n = 0;
+		for (unsigned i = 0; i < scenmgr.num_experiments(); i++)
+			n += scenmgr.get_experiment(i)->distance() > 0;
+		return n;
+	});
+}
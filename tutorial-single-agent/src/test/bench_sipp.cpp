@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "SIPP.hpp"
+#include "lifelong_sipp.hpp"
+#include "cstr_table.hpp"
+#include "dynscens.hpp"
+#include "gridmap.hpp"
+using namespace std;
+
+// Mean SIPP query time over every target of the first scenario of a JSON
+// file, next to how dense the safe intervals are: successor generation only
+// looks at the intervals a move can actually enter, so its cost should
+// follow the number of successors rather than the intervals per cell.
+// `run_many` settling every target in one search is timed against that.
+// Then simulate a replanning loop where every tick a few cells gain and
+// lose constraints: patching the solver's table is timed against building
+// a new solver, and the costs of both are checked to agree. A lifelong
+// SIPP kept on the first target repairs its search after each tick; its
+// replan time and expansions are set against a search from scratch.
+int main(int argc, char** argv) {
+	// ./bench_sipp <mapfile> <scenfile> [repeats]
+	if (argc < 3) {
+		cerr << "Usage: ./bench_sipp <mapfile> <scenfile> [repeats]" << endl;
+		return 1;
+	}
+	movingai::gridmap g(argv[1]);
+	vector<dynenv::DynScen> scens;
+	dynenv::load_and_parse_json(argv[2], scens);
+	if (scens.empty()) {
+		cerr << "err; no scenario in " << argv[2] << endl;
+		return 1;
+	}
+	int repeats = argc > 3 ? atoi(argv[3]) : 100;
+	auto& scen = scens[0];
+
+	auto table = make_shared<const dynenv::CSTRTable>(g, scen.node_constraints);
+	int constrained = 0, most = 0;
+	for (int c = 0; c < table->num_cells; c++) {
+		if (table->unsafe.len[c] == 0)
+			continue;
+		constrained++;
+		most = max(most, table->num_safe(c));
+	}
+	printf("cells %d, constrained %d, safe intervals %zu, per constrained cell max %d\n",
+			table->num_cells, constrained, table->num_slots(), most);
+
+	SIPP solver(g, table, g.width_, g.height_);
+	int sx = scen.source % g.width_, sy = scen.source / g.width_;
+	int queries = 0;
+	size_t nodes = 0;
+	auto t0 = chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++)
+		for (auto t : scen.targetSet) {
+			solver.run(sx, sy, t % g.width_, t / g.width_);
+			nodes += solver.nodes.size();
+			queries++;
+		}
+	double total = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+	printf("queries %d, mean query %.6fs, generated nodes per query %.1f\n",
+			queries, total / max(queries, 1), (double)nodes / max(queries, 1));
+
+	// every target from one search tree against one search per target
+	vector<pair<movingai::vid, movingai::vid>> targets;
+	for (auto t : scen.targetSet)
+		targets.push_back({t % g.width_, t / g.width_});
+	vector<SIPP::Cost> many;
+	auto t3 = chrono::steady_clock::now();
+	for (int r = 0; r < repeats; r++)
+		many = solver.run_many(sx, sy, targets);
+	double one_to_many = chrono::duration<double>(chrono::steady_clock::now() - t3).count();
+	size_t many_nodes = solver.nodes.size();
+	int differ = 0;
+	for (size_t i = 0; i < targets.size(); i++)
+		differ += many[i] != solver.run(sx, sy, targets[i].first, targets[i].second);
+	printf("one-to-many %.6fs per source, per target %.6fs per source (%.1fx), generated nodes %zu, mismatches %d\n",
+			one_to_many / repeats, total / repeats, total / max(one_to_many, 1e-12), many_nodes, differ);
+
+	const int ticks = 200, per_tick = 5;
+	mt19937 rng(7);
+	dynenv::NodeCSTRs cstrs = scen.node_constraints;
+	vector<pair<int, dynenv::Interval>> added;
+	double patch = 0, rebuild = 0;
+	int mismatch = 0;
+	auto goal = scen.targetSet[0];
+	int gx = goal % g.width_, gy = goal / g.width_;
+	LifelongSIPP lifelong(g, *table, g.width_, g.height_);
+	lifelong.run(sx, sy, gx, gy);
+	size_t first_expanded = lifelong.expanded, replan_expanded = 0, scratch_nodes = 0;
+	double replan = 0, scratch = 0;
+	int lifelong_mismatch = 0;
+	for (int tick = 0; tick < ticks; tick++) {
+		auto t1 = chrono::steady_clock::now();
+		// constraints live for two ticks
+		size_t expired = added.size() > 2 * per_tick ? per_tick : 0;
+		for (size_t i = 0; i < expired; i++) {
+			auto [cell, iv] = added[i];
+			solver.remove_constraint(cell, iv);
+		}
+		for (int i = 0; i < per_tick; i++) {
+			int cell = rng() % table->num_cells;
+			dynenv::Interval iv{(dynenv::Time)(tick + rng() % 20), 0};
+			iv.tr = iv.tl + rng() % 4;
+			solver.add_constraint(cell, iv);
+			added.push_back({cell, iv});
+		}
+		patch += chrono::duration<double>(chrono::steady_clock::now() - t1).count();
+		auto t4 = chrono::steady_clock::now();
+		for (size_t i = 0; i < expired; i++)
+			lifelong.remove_constraint(added[i].first, added[i].second);
+		for (size_t i = added.size() - per_tick; i < added.size(); i++)
+			lifelong.add_constraint(added[i].first, added[i].second);
+		auto repaired = lifelong.replan();
+		replan += chrono::duration<double>(chrono::steady_clock::now() - t4).count();
+		replan_expanded += lifelong.expanded;
+
+		for (size_t i = 0; i < expired; i++) {
+			auto& ivs = cstrs[added[i].first];
+			for (size_t j = 0; j < ivs.size(); j++)
+				if (ivs[j].tl == added[i].second.tl && ivs[j].tr == added[i].second.tr) {
+					ivs.erase(ivs.begin() + j);
+					break;
+				}
+		}
+		added.erase(added.begin(), added.begin() + expired);
+		for (size_t i = added.size() - per_tick; i < added.size(); i++)
+			cstrs[added[i].first].push_back(added[i].second);
+		auto t2 = chrono::steady_clock::now();
+		SIPP fresh(g, cstrs, g.width_, g.height_);
+		rebuild += chrono::duration<double>(chrono::steady_clock::now() - t2).count();
+
+		auto t = scen.targetSet[tick % scen.targetSet.size()];
+		mismatch += solver.run(sx, sy, t % g.width_, t / g.width_) != fresh.run(sx, sy, t % g.width_, t / g.width_);
+
+		auto t5 = chrono::steady_clock::now();
+		auto from_scratch = fresh.run(sx, sy, gx, gy);
+		scratch += chrono::duration<double>(chrono::steady_clock::now() - t5).count();
+		scratch_nodes += fresh.nodes.size();
+		lifelong_mismatch += repaired != from_scratch;
+	}
+	printf("ticks %d, %d new constraints per tick, patch %.6fs per tick, rebuild %.6fs per tick (%.1fx), mismatches %d\n",
+			ticks, per_tick, patch / ticks, rebuild / ticks, rebuild / max(patch, 1e-12), mismatch);
+	printf("lifelong: first search %zu expansions, replan %.6fs and %.1f expansions per tick, search from scratch %.6fs and %.1f generated nodes (%.1fx), mismatches %d\n",
+			first_expanded, replan / ticks, (double)replan_expanded / ticks, scratch / ticks,
+			(double)scratch_nodes / ticks, scratch / max(replan, 1e-12), lifelong_mismatch);
+}
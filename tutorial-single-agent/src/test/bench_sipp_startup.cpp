@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include "SIPP.hpp"
+#include "cstr_table.hpp"
+#include "dynscens.hpp"
+#include "gridmap.hpp"
+using namespace std;
+
+// Time to first plan on a large synthetic map: building the constraint
+// table (eager on one thread, eager on all hardware threads, or lazy where
+// cells are derived on first touch) plus the solver and one short query.
+// All tables must agree on the cost, and both eager ones on the layout.
+int main(int argc, char** argv) {
+	// ./bench_sipp_startup [size] [constrained cells] [query length] [threads]
+	int size = argc > 1 ? atoi(argv[1]) : 1024;
+	int constrained = argc > 2 ? atoi(argv[2]) : 200000;
+	int len = argc > 3 ? atoi(argv[3]) : 40;
+	int hw = argc > 4 ? atoi(argv[4]) : max(1u, thread::hardware_concurrency());
+
+	mt19937 rng(7);
+	movingai::gridmap g(size, size);
+	for (int i = 0; i < size * size / 10; i++)
+		g.set_label({(int)(rng() % size), (int)(rng() % size)}, true);
+	int sx = size / 2, sy = size / 2, gx = sx + len, gy = sy;
+	g.set_label({sx, sy}, false);
+	g.set_label({gx, gy}, false);
+	g.build_components();
+
+	dynenv::NodeCSTRs cstrs;
+	for (int i = 0; i < constrained; i++) {
+		auto& ivs = cstrs[rng() % (size * size)];
+		for (int k = 0; k < 3; k++) {
+			dynenv::Time tl = rng() % 200;
+			ivs.push_back({tl, (dynenv::Time)(tl + rng() % 5)});
+		}
+	}
+	printf("map %dx%d, constrained cells %zu, query length %d\n", size, size, cstrs.size(), len);
+
+	struct Mode {
+		string name;
+		bool lazy;
+		int threads;
+	};
+	vector<Mode> modes = {{"eager x1", false, 1}, {"eager x" + to_string(hw), false, hw}, {"lazy", true, 1}};
+	vector<int> costs;
+	vector<shared_ptr<const dynenv::CSTRTable>> tables;
+	for (auto& m : modes) {
+		auto t0 = chrono::steady_clock::now();
+		auto table = make_shared<const dynenv::CSTRTable>(g, cstrs, m.lazy, m.threads);
+		auto t1 = chrono::steady_clock::now();
+		SIPP solver(g, table, g.width_, g.height_);
+		costs.push_back(solver.run(sx, sy, gx, gy));
+		tables.push_back(table);
+		auto t2 = chrono::steady_clock::now();
+		printf("%-9s table %.6fs, solver + query %.6fs, first plan %.6fs, cost %d, slots %zu\n",
+				m.name.c_str(), chrono::duration<double>(t1 - t0).count(),
+				chrono::duration<double>(t2 - t1).count(),
+				chrono::duration<double>(t2 - t0).count(), costs.back(), table->num_slots());
+	}
+	if (count(costs.begin(), costs.end(), costs[0]) != (long)costs.size()) {
+		cerr << "err; tables disagree on the cost" << endl;
+		return 1;
+	}
+	auto same = [](const dynenv::CSTRTable::Ranges& a, const dynenv::CSTRTable::Ranges& b) {
+		auto eq = [](const dynenv::Interval& x, const dynenv::Interval& y) { return x.tl == y.tl && x.tr == y.tr; };
+		return a.off == b.off && a.len == b.len && equal(a.data.begin(), a.data.end(), b.data.begin(), b.data.end(), eq);
+	};
+	if (!same(tables[0]->raw, tables[1]->raw) || !same(tables[0]->unsafe, tables[1]->unsafe) ||
+			!same(tables[0]->safe, tables[1]->safe)) {
+		cerr << "err; eager tables differ between thread counts" << endl;
+		return 1;
+	}
+}
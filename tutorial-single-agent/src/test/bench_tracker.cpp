@@ -0,0 +1,81 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "moving_target.hpp"
+using namespace std;
+
+// STStateTracker::getCoordinatesAtTime used to scan the trajectory
+// backwards for every lookup, it now reads a time index built at load.
+// Time random lookups with the index and with the former scan (kept here
+// as the reference) on the given trajectory files and on synthetic
+// 1M-step ones, one per time step (dense index) and one with gaps of up
+// to 50 steps between states (run index), and check that both agree.
+
+// the former lookup
+pair<vid, vid> scan(const STStateTracker& tr, Time t) {
+	const auto& states = tr.states;
+	if (t >= states.back().t)
+		return {states.back().x, states.back().y};
+	if (t < states.front().t)
+		return {states.front().x, states.front().y};
+	for (size_t i = states.size() - 1; i > 0; --i)
+		if (states[i - 1].t <= t && states[i].t > t)
+			return {states[i - 1].x, states[i - 1].y};
+	return {states.front().x, states.front().y};
+}
+
+void bench(const string& name, const STStateTracker& tr, int queries, mt19937& rng) {
+	Time span = tr.states.back().t + 10;
+	vector<Time> ts(queries);
+	for (auto& t : ts)
+		t = rng() % span;
+	long sum = 0;
+	auto t0 = chrono::steady_clock::now();
+	for (auto t : ts) {
+		auto p = tr.getCoordinatesAtTime(t);
+		sum += p.first + p.second;
+	}
+	auto t1 = chrono::steady_clock::now();
+	// the scan is slow on long trajectories, time a sample of the queries
+	int scanned = min<int>(queries, max<int>(100, 20000000 / tr.states.size()));
+	int mismatch = 0;
+	for (int i = 0; i < scanned; i++) {
+		auto p = scan(tr, ts[i]);
+		sum += p.first + p.second;
+	}
+	auto t2 = chrono::steady_clock::now();
+	for (int i = 0; i < scanned; i++)
+		mismatch += scan(tr, ts[i]) != tr.getCoordinatesAtTime(ts[i]);
+	double indexed = chrono::duration<double>(t1 - t0).count() / queries;
+	double linear = chrono::duration<double>(t2 - t1).count() / scanned;
+	printf("%-28s states %8zu, indexed %.3fns per lookup, scan %.3fns per lookup (%.1fx), mismatches %d (%ld)\n",
+			name.c_str(), tr.states.size(), indexed * 1e9, linear * 1e9, linear / max(indexed, 1e-15), mismatch, sum % 10);
+}
+
+int main(int argc, char** argv) {
+	// ./bench_tracker [trajectory files...]
+	mt19937 rng(11);
+	for (int i = 1; i < argc; i++) {
+		STStateTracker tr;
+		if (!tr.loadStatesFromFile(argv[i]) || tr.states.empty())
+			continue;
+		bench(argv[i], tr, 1000000, rng);
+	}
+	const int steps = 1000000;
+	for (int gap : {1, 50}) {
+		STStateTracker tr;
+		vid x = 500, y = 500;
+		Time t = 0;
+		for (int i = 0; i < steps; i++) {
+			tr.states.emplace_back(x, y, t);
+			int d = rng() % 5;
+			x += d == 0 ? 1 : d == 1 ? -1 : 0;
+			y += d == 2 ? 1 : d == 3 ? -1 : 0;
+			t += gap == 1 ? 1 : 1 + rng() % gap;
+		}
+		tr.buildIndex();
+		bench(gap == 1 ? "synthetic, every step" : "synthetic, gaps up to 50", tr, 1000000, rng);
+	}
+}
@@ -1,13 +1,67 @@
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <string>
+#include <thread>
 #include "gridmap.hpp"
 #include "Astar.hpp"
+#include "FixedAstar.hpp"
+#include "JPS.hpp"
+#include "JPSPlus.hpp"
+#include "landmarks.hpp"
 #include "load_scens.hpp"
 using namespace std;
 
-void run(movingai::gridmap& g, movingai::scenario_manager& scenmrg) {
+// distance and path of one query, as printed by `run`
+string describe(movingai::gridmap& g, int sx, int sy, int gx, int gy, double dist, const vector<int>& parent) {
+	char buf[128];
+	snprintf(buf, sizeof(buf), "From (%d, %d) to (%d, %d) shortest distance: %.5f\n", sx, sy, gx, gy, dist);
+	string out = buf;
 
-	Astar solver(g, g.width_, g.height_);
+	// construct the path based on vector<int>parent;
+	if (dist == -1) {
+		out += "No path found\n";
+	}
+	else {
+		vector<State> path;
+		State current(gx, gy);
+		while (current.x != sx || current.y != sy) {
+			path.push_back(current);
+			int parent_id = parent[current.y * g.width_ + current.x];
+			current.x = parent_id % g.width_;
+			current.y = parent_id / g.width_;
+		}
+		if (path.empty()) {
+			snprintf(buf, sizeof(buf), "Path: (%d,%d)\n", sx, sy);
+			out += buf;
+		}
+		else {
+			out += "Path: ";
+			reverse(path.begin(), path.end());
+			for (size_t j = 0; j < path.size(); ++j) {
+				snprintf(buf, sizeof(buf), "(%d,%d)%s", path[j].x, path[j].y, (j == path.size() - 1) ? "" : " -> ");
+				out += buf;
+			}
+			out += "\n";
+		}
+	}
+	return out;
+}
+
+// attach the differential heuristic to solvers that take one
+template <typename Solver>
+void attach(Solver& solver, const Landmarks* lm) {
+	if constexpr (requires { solver.landmarks; })
+		solver.landmarks = lm;
+}
+
+template <typename Solver>
+void run(movingai::gridmap& g, movingai::scenario_manager& scenmrg, const Landmarks* lm) {
+
+	Solver solver(g, g.width_, g.height_);
+	attach(solver, lm);
+	vector<int> parent;
 	for (int i=0; i<scenmrg.num_experiments(); i++) {
 		auto expr = scenmrg.get_experiment(i);
 		auto sx = expr->startx();
@@ -15,46 +69,168 @@ void run(movingai::gridmap& g, movingai::scenario_manager& scenmrg) {
 		auto gx = expr->goalx();
 		auto gy = expr->goaly();
 
-		vector<int> parent;
-		parent.assign(static_cast<size_t>(g.width_) * g.height_, -1);
 		auto dist = solver.run(sx, sy, gx, gy, parent);
-		printf("From (%d, %d) to (%d, %d) shortest distance: %.5f\n", sx, sy, gx, gy, dist);
+		fputs(describe(g, sx, sy, gx, gy, dist, parent).c_str(), stdout);
+	}
+}
 
-		// TODO: postprocess
-		// construct the path based on vector<int>parent;
-		if (dist == -1) {
-			printf("No path found\n");
-		}
-		else {
-			vector<State> path;
-			State current(gx, gy);
-			while (current.x != sx || current.y != sy) {
-				path.push_back(current);
-				int parent_id = parent[current.y * g.width_ + current.x];
-				current.x = parent_id % g.width_;
-				current.y = parent_id / g.width_;
-			}
-			if (path.empty()) {
-				printf("Path: (%d,%d)\n", sx, sy);
-			}
-			else {
-				printf("Path: ");
-				reverse(path.begin(), path.end());
-				for (size_t j = 0; j < path.size(); ++j) {
-                    printf("(%d,%d)%s", path[j].x, path[j].y, (j == path.size() - 1) ? "" : " -> ");
-                }
-                printf("\n");
+// shard the experiments over `threads` workers, each with its own solver
+// (copied from one built up front) and the gridmap shared read-only;
+// results are printed in the original order, followed by a summary
+template <typename Solver>
+void batch(movingai::gridmap& g, movingai::scenario_manager& scenmrg, int threads, const Landmarks* lm) {
+	Solver proto(g, g.width_, g.height_);
+	attach(proto, lm);
+	int n = scenmrg.num_experiments();
+	vector<string> out(n);
+	vector<double> latency(n);
+	atomic<int> next(0);
+	// small chunks keep the workers balanced, long queries cluster in high buckets
+	const int chunk = 8;
+
+	auto worker = [&]() {
+		Solver solver(proto);
+		vector<int> parent;
+		for (int begin = next.fetch_add(chunk); begin < n; begin = next.fetch_add(chunk)) {
+			for (int i = begin; i < min(begin + chunk, n); i++) {
+				auto expr = scenmrg.get_experiment(i);
+				auto tstart = chrono::steady_clock::now();
+				auto dist = solver.run(expr->startx(), expr->starty(), expr->goalx(), expr->goaly(), parent);
+				latency[i] = chrono::duration<double>(chrono::steady_clock::now() - tstart).count();
+				out[i] = describe(g, expr->startx(), expr->starty(), expr->goalx(), expr->goaly(), dist, parent);
 			}
 		}
+	};
+
+	auto tstart = chrono::steady_clock::now();
+	vector<thread> pool;
+	for (int t = 0; t < threads; t++)
+		pool.emplace_back(worker);
+	for (auto& th : pool)
+		th.join();
+	double wall = chrono::duration<double>(chrono::steady_clock::now() - tstart).count();
+
+	for (auto& text : out)
+		fputs(text.c_str(), stdout);
+
+	map<int, vector<double>> buckets;
+	for (int i = 0; i < n; i++)
+		buckets[scenmrg.get_experiment(i)->bucket()].push_back(latency[i]);
+	printf("threads %d, queries %d, wall %fs, throughput %.1f queries/s\n", threads, n, wall, n / max(wall, 1e-9));
+	for (auto& [bucket, ls] : buckets) {
+		sort(ls.begin(), ls.end());
+		double sum = 0;
+		for (double l : ls)
+			sum += l;
+		printf("bucket %d: queries %zu, mean %.6fs, p50 %.6fs, p99 %.6fs, max %.6fs\n",
+				bucket, ls.size(), sum / ls.size(), ls[ls.size() / 2],
+				ls[min(ls.size() - 1, ls.size() * 99 / 100)], ls.back());
+	}
+}
+
+// solve every experiment with Astar, fixed-point Astar, JPS and JPS+,
+// report expansions and runtime of each; the landmarks, if any, are
+// attached to all but the fixed-point Astar, which stays the reference
+void compare(movingai::gridmap& g, movingai::scenario_manager& scenmrg, const Landmarks* lm) {
+	Astar astar(g, g.width_, g.height_);
+	FixedAstar fixed(g, g.width_, g.height_);
+	JPS jps(g, g.width_, g.height_);
+	auto tprep = chrono::steady_clock::now();
+	JPSPlus jpsplus(g, g.width_, g.height_);
+	printf("jps+ table %s in %fs\n", jpsplus.loaded ? "loaded" : "built",
+			chrono::duration<double>(chrono::steady_clock::now() - tprep).count());
+	attach(astar, lm);
+	attach(jps, lm);
+	attach(jpsplus, lm);
+	vector<int> parent;
+	long exp[4] = {0, 0, 0, 0};
+	double total[4] = {0, 0, 0, 0};
+	int mismatch = 0;
+	for (int i=0; i<scenmrg.num_experiments(); i++) {
+		auto expr = scenmrg.get_experiment(i);
+		auto sx = expr->startx();
+		auto sy = expr->starty();
+		auto gx = expr->goalx();
+		auto gy = expr->goaly();
+
+		auto t0 = chrono::steady_clock::now();
+		auto d1 = astar.run(sx, sy, gx, gy, parent);
+		auto t1 = chrono::steady_clock::now();
+		auto d2 = fixed.run(sx, sy, gx, gy, parent);
+		auto t2 = chrono::steady_clock::now();
+		auto d3 = jps.run(sx, sy, gx, gy, parent);
+		auto t3 = chrono::steady_clock::now();
+		auto d4 = jpsplus.run(sx, sy, gx, gy, parent);
+		auto t4 = chrono::steady_clock::now();
+		double rt[4] = {chrono::duration<double>(t1 - t0).count(),
+			chrono::duration<double>(t2 - t1).count(),
+			chrono::duration<double>(t3 - t2).count(),
+			chrono::duration<double>(t4 - t3).count()};
+		int ex[4] = {astar.expanded, fixed.expanded, jps.expanded, jpsplus.expanded};
+
+		bool same = fabs(d1 - d2) < 1e-6 && fabs(d1 - d3) < 1e-6 && fabs(d1 - d4) < 1e-6;
+		mismatch += !same;
+		for (int k = 0; k < 4; k++) {
+			exp[k] += ex[k];
+			total[k] += rt[k];
+		}
+		printf("[%d] (%d, %d) to (%d, %d) dist %.5f | astar: expanded %d runtime %fs | fixed: expanded %d runtime %fs | jps: expanded %d runtime %fs | jps+: expanded %d runtime %fs%s\n",
+				i, sx, sy, gx, gy, d1, ex[0], rt[0], ex[1], rt[1], ex[2], rt[2], ex[3], rt[3], same ? "" : " MISMATCH");
+	}
+	const char* names[4] = {"astar", "fixed", "jps", "jps+"};
+	for (int k = 0; k < 4; k++) {
+		printf("total %s: expanded %ld runtime %fs", names[k], exp[k], total[k]);
+		if (k > 0)
+			printf(" (expansion reduction %.2fx, speedup %.2fx)",
+					(double)exp[0] / max(exp[k], 1L), total[0] / max(total[k], 1e-9));
+		printf("\n");
 	}
+	printf("mismatches %d\n", mismatch);
 }
 
 int main(int argc, char** argv) {
-	// ./run_astar <mapfile> <scenfile>
+	// ./run_astar <mapfile> <scenfile> [--fixed | --jps | --jpsplus | --compare] [--threads N] [--landmarks K]
 	string mapfile = string(argv[1]);
 	string scenfile = string(argv[2]);
+	string mode;
+	int threads = 0;
+	int num_landmarks = 0;
+	for (int i = 3; i < argc; i++) {
+		if (string(argv[i]) == "--threads" && i + 1 < argc)
+			threads = max(1, atoi(argv[++i]));
+		else if (string(argv[i]) == "--landmarks" && i + 1 < argc)
+			num_landmarks = max(0, atoi(argv[++i]));
+		else
+			mode = string(argv[i]);
+	}
 	movingai::gridmap g(mapfile);
 	movingai::scenario_manager scenmrg;
 	scenmrg.load_scenario(scenfile);
-	run(g, scenmrg);
+	unique_ptr<Landmarks> lm;
+	if (num_landmarks > 0) {
+		auto tprep = chrono::steady_clock::now();
+		lm = make_unique<Landmarks>(g, num_landmarks);
+		fprintf(stderr, "landmarks %zu %s in %fs\n", lm->points.size(), lm->loaded ? "loaded" : "built",
+				chrono::duration<double>(chrono::steady_clock::now() - tprep).count());
+	}
+	if (mode == "--compare")
+		compare(g, scenmrg, lm.get());
+	else if (threads > 0) {
+		if (mode == "--fixed")
+			batch<FixedAstar>(g, scenmrg, threads, lm.get());
+		else if (mode == "--jps")
+			batch<JPS>(g, scenmrg, threads, lm.get());
+		else if (mode == "--jpsplus")
+			batch<JPSPlus>(g, scenmrg, threads, lm.get());
+		else
+			batch<Astar>(g, scenmrg, threads, lm.get());
+	}
+	else if (mode == "--fixed")
+		run<FixedAstar>(g, scenmrg, lm.get());
+	else if (mode == "--jps")
+		run<JPS>(g, scenmrg, lm.get());
+	else if (mode == "--jpsplus")
+		run<JPSPlus>(g, scenmrg, lm.get());
+	else
+		run<Astar>(g, scenmrg, lm.get());
 }
@@ -34,7 +34,9 @@ void save_path(const SIPP& solver, const std::vector<SIPP::STState>& path, const
 }
 
 void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_prefix) {
-    SIPP solver(g, scen.node_constraints, g.width_, g.height_);
+    // both solvers share the constraint table of the scenario
+    auto table = make_shared<const dynenv::CSTRTable>(g, scen.node_constraints);
+    SIPP solver(g, table, g.width_, g.height_);
     auto sy = 8;
     auto sx = 15;
     STStateTracker tracker;
@@ -73,7 +75,7 @@ void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_p
     auto tnow = std::chrono::steady_clock::now();
     auto tcost = chrono::duration<double>(tnow - tstart).count();
     printf("SIPP:  runtime: %fs\n", tcost);
-    mt_SIPP mt_solver(g, scen.node_constraints, g.width_, g.height_);
+    mt_SIPP mt_solver(g, table, g.width_, g.height_);
     tstart = std::chrono::steady_clock::now();
     auto mt_cost = mt_solver.run(sx, sy, 108, tracker);
     tnow = std::chrono::steady_clock::now();
@@ -82,6 +84,13 @@ void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_p
     printf("mt_SIPP:  runtime: %fs with cost %d at (%d, %d)\n", tcost, mt_cost, found_target.first, found_target.second);
     auto path = mt_solver.get_path();
     mt_solver.validate(path);
+    // interception time for every departure of the first 200 steps
+    tstart = std::chrono::steady_clock::now();
+    auto profile = mt_solver.run_profile(sx, sy, 0, 199, tracker);
+    tnow = std::chrono::steady_clock::now();
+    tcost = chrono::duration<double>(tnow - tstart).count();
+    printf("mt_SIPP profile:  runtime: %fs with %zu pieces over [0, 199], departing at 108 meets at %d\n",
+           tcost, profile.pieces.size(), profile.arrival(108));
 }
 
 string get_map_type_prefix(const string& scen_filename) {
@@ -7,6 +7,8 @@
 #include "SIPP.hpp"
 #include "dynscens.hpp"
 #include "gridmap.hpp"
+#include "landmarks.hpp"
+#include "load_scens.hpp"
 
 namespace fs = std::filesystem;
 using namespace std;
@@ -31,13 +33,37 @@ void save_path(const SIPP& solver, const std::vector<SIPP::STState>& path, const
     }
 }
 
-void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_prefix) {
-    SIPP solver(g, scen.node_constraints, g.width_, g.height_);
+void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_prefix, const Landmarks* lm, bool lazy, bool many, double w) {
+    // a lazy table derives the safe intervals of a cell when a search first reaches it
+    auto table = make_shared<const dynenv::CSTRTable>(g, scen.node_constraints, lazy);
+    SIPP solver(g, table, g.width_, g.height_);
+    solver.landmarks = lm;
     auto sy = scen.source / g.width_;
     auto sx = scen.source % g.width_;
 
     fs::path output_dir_path(output_dir_prefix);
 
+    if (many) {
+        // one search tree settles every target
+        vector<pair<movingai::vid, movingai::vid>> targets;
+        for (auto t : scen.targetSet)
+            targets.push_back({t % g.width_, t / g.width_});
+        auto tstart = std::chrono::steady_clock::now();
+        auto costs = solver.run_many(sx, sy, targets);
+        auto tcost = chrono::duration<double>(std::chrono::steady_clock::now() - tstart).count();
+        cout << format("\tSIPP: {} targets runtime: {:3f}s", targets.size(), tcost) << endl;
+        for (size_t i = 0; i < targets.size(); i++) {
+            auto t = scen.targetSet[i];
+            cout << format("[{}]({}, {}) to [{}]({}, {}): cost {}",
+                           scen.source, sx, sy, t, targets[i].first, targets[i].second, costs[i])
+                 << endl;
+            auto path = solver.get_path(solver.many_best[i]);
+            string plan_filename_base = to_string(scen.source) + "-" + to_string(t) + "-plan.txt";
+            save_path(solver, path, (output_dir_path / plan_filename_base).string());
+        }
+        return;
+    }
+
     for (auto t : scen.targetSet) {
         auto ty = t / g.width_;
         auto tx = t % g.width_;
@@ -49,6 +75,17 @@ void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_p
         cout << format("[{}]({}, {}) to [{}]({}, {}): cost {}",
                        scen.source, sx, sy, t, tx, ty, cost)
              << endl;
+        if (w > 0) {
+            // the focal search replaces the optimal one in the plan file
+            size_t optimal_expanded = solver.expanded;
+            tstart = std::chrono::steady_clock::now();
+            auto focal_cost = solver.run_focal(sx, sy, tx, ty, w);
+            auto fcost = chrono::duration<double>(std::chrono::steady_clock::now() - tstart).count();
+            cout << format("\tfocal w={}: cost {} (certified <= {:.3f} x optimal) runtime: {:3f}s expansions {} vs {} optimal ({:3f}s)",
+                           w, focal_cost, solver.lower_bound > 0 ? (double)focal_cost / solver.lower_bound : 1.0,
+                           fcost, solver.expanded, optimal_expanded, tcost)
+                 << endl;
+        }
 
         auto path = solver.get_path();
 
@@ -59,6 +96,27 @@ void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_p
     }
 }
 
+// static MovingAI workloads (`.scen`, as run by run_astar) under 8-connected
+// moves and waiting, one step each and no dynamic obstacle
+void run_movingai(movingai::gridmap& g, const string& scenfile) {
+    movingai::scenario_manager scenmrg;
+    scenmrg.load_scenario(scenfile);
+    dynenv::NodeCSTRs none;
+    BasicSIPP<motion::OctileWait> solver(g, none, g.width_, g.height_);
+    double total = 0;
+    for (int i = 0; i < (int)scenmrg.num_experiments(); i++) {
+        auto expr = scenmrg.get_experiment(i);
+        auto tstart = std::chrono::steady_clock::now();
+        auto cost = solver.run(expr->startx(), expr->starty(), expr->goalx(), expr->goaly());
+        auto tcost = chrono::duration<double>(std::chrono::steady_clock::now() - tstart).count();
+        total += tcost;
+        cout << format("[{}] ({}, {}) to ({}, {}): cost {} expanded {} runtime: {:3f}s", i,
+                       expr->startx(), expr->starty(), expr->goalx(), expr->goaly(), cost, solver.expanded, tcost)
+             << endl;
+    }
+    cout << format("total runtime: {:3f}s", total) << endl;
+}
+
 string get_map_type_prefix(const string& scen_filename) {
     fs::path p(scen_filename);
     string stem = p.stem().string(); 
@@ -73,12 +131,27 @@ string get_map_type_prefix(const string& scen_filename) {
 
 int main(int argc, char** argv) {
     if (argc < 3) {
-        cerr << "Usage: ./run_sipp <mapfile> <scenfile>" << endl;
+        cerr << "Usage: ./run_sipp <mapfile> <scenfile | .scen> [--landmarks K] [--lazy] [--many] [--w W]" << endl;
         return 1;
     }
 
     string mapfile = string(argv[1]);
     string scenfile = string(argv[2]);
+    int num_landmarks = 0;
+    bool lazy = false;
+    bool many = false;
+    // suboptimality weight of the focal search, none if 0
+    double w = 0;
+    for (int i = 3; i < argc; i++) {
+        if (string(argv[i]) == "--landmarks" && i + 1 < argc)
+            num_landmarks = max(0, atoi(argv[++i]));
+        else if (string(argv[i]) == "--lazy")
+            lazy = true;
+        else if (string(argv[i]) == "--many")
+            many = true;
+        else if (string(argv[i]) == "--w" && i + 1 < argc)
+            w = max(1.0, atof(argv[++i]));
+    }
 
     movingai::gridmap g(mapfile);
     if (g.width_ == 0 || g.height_ == 0) {
@@ -86,6 +159,11 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (fs::path(scenfile).extension() == ".scen") {
+        run_movingai(g, scenfile);
+        return 0;
+    }
+
     vector<dynenv::DynScen> scens;
     dynenv::load_and_parse_json(scenfile, scens); 
 
@@ -100,8 +178,12 @@ int main(int argc, char** argv) {
     fs::path full_output_dir_prefix = output_base_dir / map_type;
     printf("Output dir: %s\n", full_output_dir_prefix.string().c_str());
     
+    unique_ptr<Landmarks> lm;
+    if (num_landmarks > 0)
+        lm = make_unique<Landmarks>(g, num_landmarks, movingai::gridmap::CARDINAL);
+
     if (!scens.empty()) {
-        run(g, scens[0], full_output_dir_prefix.string());
+        run(g, scens[0], full_output_dir_prefix.string(), lm.get(), lazy, many, w);
     }
 
     return 0;
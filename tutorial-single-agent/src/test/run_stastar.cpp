@@ -6,6 +6,7 @@
 #include "STAstar.hpp"
 #include "dynscens.hpp"
 #include "gridmap.hpp"
+#include "landmarks.hpp"
 using namespace std;
 namespace fs = std::filesystem;
 
@@ -16,11 +17,29 @@ void save_path(const vector<STAstar::STState>& path, string fn) {
 	}
 }
 
-void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_prefix) {
+void run(movingai::gridmap& g, dynenv::DynScen& scen, const string& output_dir_prefix, const Landmarks* lm, bool many) {
 
 	STAstar solver(g, scen.node_constraints, g.width_, g.height_);
+	solver.landmarks = lm;
 	auto sy = scen.source / g.width_;
     auto sx = scen.source % g.width_;
+	if (many) {
+		// one sweep settles every target
+		vector<pair<movingai::vid, movingai::vid>> targets;
+		for (auto t: scen.targetSet)
+			targets.push_back({t % g.width_, t / g.width_});
+		auto costs = solver.run_many(sx, sy, targets);
+		for (size_t i = 0; i < targets.size(); i++) {
+			auto t = scen.targetSet[i];
+			cout << format("[{}]({}, {}) to [{}]({}, {}): cost {}", 
+					scen.source, sx, sy, t, targets[i].first, targets[i].second, costs[i]) << endl;
+			auto path = solver.get_path_to(i);
+			assert (solver.validate(path));
+			string plan_filename_base = to_string(scen.source) + "-" + to_string(t) + "-plan.txt";
+			save_path(path, (fs::path(output_dir_prefix) / plan_filename_base).string());
+		}
+		return;
+	}
 	for (auto t: scen.targetSet) {
 		auto ty = t / g.width_;
         auto tx = t % g.width_;
@@ -49,10 +68,18 @@ string get_map_type_prefix(const string& filename) {
 }
 
 int main(int argc, char** argv) {
-	// ./run_astar <mapfile> <scenfile>
+	// ./run_stastar <mapfile> <scenfile> [--landmarks K] [--many]
 	string mapfile = string(argv[1]);
 	string scenfile = string(argv[2]);
 	movingai::gridmap g(mapfile);
+	unique_ptr<Landmarks> lm;
+	bool many = false;
+	for (int i = 3; i < argc; i++) {
+		if (string(argv[i]) == "--landmarks" && i + 1 < argc && atoi(argv[i + 1]) > 0)
+			lm = make_unique<Landmarks>(g, atoi(argv[++i]), movingai::gridmap::CARDINAL);
+		else if (string(argv[i]) == "--many")
+			many = true;
+	}
 	dynenv::DynScen scen;
 	vector<dynenv::DynScen> scens;
 	string map_type = get_map_type_prefix(scenfile);
@@ -60,5 +87,5 @@ int main(int argc, char** argv) {
 	fs::path scen_dir = fs::path(scenfile).parent_path(); // Gets the directory part, e.g., "../scens"
 	fs::path stastar_dir = scen_dir / "stastar-res";
     fs::path full_path = scen_dir / map_type;
-	run(g, scens[0], full_path);
+	run(g, scens[0], full_path, lm.get(), many);
 }
@@ -0,0 +1,42 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "gridmap.hpp"
+
+// Convert an octile `.map` into the binary gridmap format,
+// then reload it and check that both maps agree.
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "Usage: ./map2bin <mapfile> <outfile> [--bits-only]" << std::endl;
+    return 1;
+  }
+  std::string mapfile = std::string(argv[1]);
+  std::string outfile = std::string(argv[2]);
+  uint32_t flags = movingai::GMB_NMASK | movingai::GMB_COMPONENTS;
+  if (argc > 3 && std::string(argv[3]) == "--bits-only")
+    flags = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  movingai::gridmap g(mapfile);
+  auto t1 = std::chrono::steady_clock::now();
+  g.save_binary(outfile, flags);
+  auto t2 = std::chrono::steady_clock::now();
+  movingai::gridmap b(outfile);
+  auto t3 = std::chrono::steady_clock::now();
+
+  for (int y = 0; y < g.height_; y++)
+    for (int x = 0; x < g.width_; x++)
+      if (g.is_obstacle({x, y}) != b.is_obstacle({x, y}) ||
+          g.neighbour_mask({x, y}) != b.neighbour_mask({x, y}) ||
+          g.component({x, y}, 4) != b.component({x, y}, 4) ||
+          g.component({x, y}, 8) != b.component({x, y}, 8)) {
+        std::cerr << "err; converted map differs at (" << x << ", " << y << ")" << std::endl;
+        return 1;
+      }
+
+  using secs = std::chrono::duration<double>;
+  printf("%s (%dx%d) -> %s\n", mapfile.c_str(), g.width_, g.height_, outfile.c_str());
+  printf("text load: %fs, write: %fs, binary load: %fs\n",
+         secs(t1 - t0).count(), secs(t2 - t1).count(), secs(t3 - t2).count());
+  return 0;
+}